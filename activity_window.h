@@ -0,0 +1,164 @@
+// activity_window.h - 滑动窗口活跃统计
+//
+// 按分钟分桶，最多保留最近 60 分钟：
+//   - 每个桶记录登录、心跳事件数（精确计数）
+//   - 每个桶带一个 HyperLogLog 草图，用于估算窗口内的去重活跃用户数
+// 内存固定（约 60 * 4KB），与在线用户数无关。非线程安全，由调用方加锁。
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ActivityWindow {
+public:
+    static constexpr int kMaxMinutes = 60;
+    static constexpr std::array<int, 3> kWindows = {5, 15, 60};
+
+    struct WindowStats {
+        int minutes = 0;
+        uint64_t active_users = 0;   // 去重活跃用户数（HLL 估算，误差约 1.6%）
+        uint64_t logins = 0;
+        uint64_t heartbeats = 0;
+    };
+
+    ActivityWindow() : buckets_(kMaxMinutes) {}
+
+    void recordLogin(const std::string& user_id, std::chrono::steady_clock::time_point now) {
+        Bucket& bucket = current(now);
+        ++bucket.logins;
+        add(bucket, user_id);
+    }
+
+    void recordHeartbeat(const std::string& user_id, std::chrono::steady_clock::time_point now) {
+        Bucket& bucket = current(now);
+        ++bucket.heartbeats;
+        add(bucket, user_id);
+    }
+
+    // 各窗口的统计：已结束分钟的合并结果在换分钟时预先算好，查询只需再合并当前分钟
+    std::vector<WindowStats> snapshot(std::chrono::steady_clock::time_point now) {
+        const Bucket& cur = current(now);
+        std::vector<WindowStats> result;
+        result.reserve(kWindows.size());
+
+        Registers merged;
+        for (size_t w = 0; w < kWindows.size(); ++w) {
+            const Closed& closed = closed_[w];
+            for (size_t i = 0; i < kRegisters; ++i) {
+                merged[i] = std::max(closed.registers[i], cur.registers[i]);
+            }
+            WindowStats stats;
+            stats.minutes = kWindows[w];
+            stats.active_users = estimate(merged);
+            stats.logins = closed.logins + cur.logins;
+            stats.heartbeats = closed.heartbeats + cur.heartbeats;
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+private:
+    static constexpr int kPrecision = 12;
+    static constexpr size_t kRegisters = size_t{1} << kPrecision;
+    using Registers = std::array<uint8_t, kRegisters>;
+
+    struct Bucket {
+        int64_t minute = -1;
+        uint64_t logins = 0;
+        uint64_t heartbeats = 0;
+        Registers registers{};
+    };
+
+    // 某个窗口内已结束分钟的合并结果
+    struct Closed {
+        uint64_t logins = 0;
+        uint64_t heartbeats = 0;
+        Registers registers{};
+    };
+
+    static int64_t minuteOf(std::chrono::steady_clock::time_point now) {
+        return std::chrono::duration_cast<std::chrono::minutes>(now.time_since_epoch()).count();
+    }
+
+    // steady_clock 起点是开机时间，刚开机时 minute - back 可能为负
+    static size_t slotOf(int64_t minute) {
+        return static_cast<size_t>(((minute % kMaxMinutes) + kMaxMinutes) % kMaxMinutes);
+    }
+
+    Bucket& current(std::chrono::steady_clock::time_point now) {
+        int64_t minute = minuteOf(now);
+        Bucket& bucket = buckets_[slotOf(minute)];
+        if (bucket.minute != minute) {
+            bucket.minute = minute;
+            bucket.logins = 0;
+            bucket.heartbeats = 0;
+            bucket.registers.fill(0);
+            rebuildClosed(minute);
+        }
+        return bucket;
+    }
+
+    // 每分钟一次：重新合并各窗口内已结束的分钟
+    void rebuildClosed(int64_t minute) {
+        for (size_t w = 0; w < kWindows.size(); ++w) {
+            Closed& closed = closed_[w];
+            closed = Closed{};
+            for (int back = 1; back < kWindows[w]; ++back) {
+                const Bucket& b = buckets_[slotOf(minute - back)];
+                if (b.minute != minute - back) continue;
+                closed.logins += b.logins;
+                closed.heartbeats += b.heartbeats;
+                for (size_t i = 0; i < kRegisters; ++i) {
+                    closed.registers[i] = std::max(closed.registers[i], b.registers[i]);
+                }
+            }
+        }
+    }
+
+    static uint64_t mix(uint64_t x) {
+        // splitmix64 finalizer，打散 std::hash 的低熵输出
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    static void add(Bucket& bucket, const std::string& user_id) {
+        uint64_t h = mix(std::hash<std::string>{}(user_id));
+        size_t index = static_cast<size_t>(h >> (64 - kPrecision));
+        uint64_t rest = h << kPrecision;
+        uint8_t rank = rest == 0 ? static_cast<uint8_t>(64 - kPrecision + 1)
+                                 : static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        if (rank > bucket.registers[index]) {
+            bucket.registers[index] = rank;
+        }
+    }
+
+    static uint64_t estimate(const Registers& registers) {
+        constexpr double m = static_cast<double>(kRegisters);
+        const double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t r : registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += (r == 0);
+        }
+        double e = alpha * m * m / sum;
+        // 小基数时线性计数更准确
+        if (e <= 2.5 * m && zeros > 0) {
+            e = m * std::log(m / static_cast<double>(zeros));
+        }
+        return static_cast<uint64_t>(e + 0.5);
+    }
+
+    std::vector<Bucket> buckets_;
+    std::array<Closed, kWindows.size()> closed_{};
+};
@@ -0,0 +1,375 @@
+// arrow_stream.h - Apache Arrow IPC 流格式写出
+//
+// 不依赖 libarrow，直接按 Arrow 列式格式规范生成 IPC 流：
+//   Schema 消息 -> 若干 RecordBatch 消息 -> 结束标记
+// 消息元数据是手工构建的 flatbuffer，消息体按列依次存放各缓冲区（8 字节对齐）。
+// 启用压缩时每个缓冲区单独用 zstd 压缩（Arrow BodyCompression，BUFFER 方式），
+// 压缩后不更小的缓冲区按规范以 -1 长度前缀原样存放。
+// 生成的字节流可直接被 pyarrow.ipc.open_stream() 等标准读端读取。
+//
+// 只支持导出需要的几种类型，且所有列都不可为空（不写有效位图）。
+#pragma once
+
+#include <zstd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace arrow_stream {
+
+enum class Type : uint8_t {
+    kUtf8,
+    kUInt32,
+    kInt64,
+    kTimestampMs,   // 毫秒时间戳，时区 UTC
+};
+
+struct Field {
+    std::string name;
+    Type type;
+};
+
+enum class Compression { kNone, kZstd };
+
+// 按行追加、按列存放的一批数据
+class BatchBuilder {
+public:
+    explicit BatchBuilder(std::vector<Field> fields)
+        : fields_(std::move(fields)), columns_(fields_.size()) {
+        clear();
+    }
+
+    const std::vector<Field>& fields() const { return fields_; }
+    size_t rows() const { return rows_; }
+
+    void clear() {
+        for (auto& column : columns_) {
+            column.offsets.assign(1, 0);
+            column.data.clear();
+        }
+        rows_ = 0;
+    }
+
+    void addString(size_t col, const std::string& value) {
+        Column& column = columns_[col];
+        column.data += value;
+        column.offsets.push_back(static_cast<int32_t>(column.data.size()));
+    }
+
+    void addUInt32(size_t col, uint32_t value) { appendFixed(col, value); }
+    void addInt64(size_t col, int64_t value) { appendFixed(col, value); }
+
+    // 每行所有列追加完后调用
+    void endRow() { ++rows_; }
+
+private:
+    friend class StreamWriter;
+
+    struct Column {
+        std::vector<int32_t> offsets;   // 仅 Utf8 使用
+        std::string data;
+    };
+
+    template <typename T>
+    void appendFixed(size_t col, T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        columns_[col].data.append(bytes, sizeof(T));
+    }
+
+    std::vector<Field> fields_;
+    std::vector<Column> columns_;
+    size_t rows_ = 0;
+};
+
+// 最小 flatbuffer 构建器：与官方实现一样从后往前写，偏移量以“距缓冲区末尾的字节数”表示
+// 只支持小端平台
+class FlatBuilder {
+public:
+    size_t size() const { return data_.size() - head_; }
+
+    uint32_t createString(const std::string& s) {
+        prep(4, s.size() + 1);
+        push<uint8_t>(0);
+        prepend(s.data(), s.size());
+        push<uint32_t>(static_cast<uint32_t>(s.size()));
+        return static_cast<uint32_t>(size());
+    }
+
+    // 结构体向量，元素按内存布局原样拷贝
+    template <typename S>
+    uint32_t createStructVector(const std::vector<S>& items) {
+        size_t bytes = items.size() * sizeof(S);
+        prep(4, bytes);
+        prep(alignof(S), bytes);
+        prepend(items.data(), bytes);
+        push<uint32_t>(static_cast<uint32_t>(items.size()));
+        return static_cast<uint32_t>(size());
+    }
+
+    uint32_t createOffsetVector(const std::vector<uint32_t>& offsets) {
+        prep(4, offsets.size() * 4);
+        for (size_t i = offsets.size(); i-- > 0; ) {
+            push<uint32_t>(static_cast<uint32_t>(size() + 4 - offsets[i]));
+        }
+        push<uint32_t>(static_cast<uint32_t>(offsets.size()));
+        return static_cast<uint32_t>(size());
+    }
+
+    void startTable() {
+        fields_.clear();
+        table_start_ = size();
+    }
+
+    template <typename T>
+    void addScalar(uint16_t slot, T value) {
+        prep(sizeof(T), 0);
+        push<T>(value);
+        fields_.push_back({slot, size()});
+    }
+
+    void addOffset(uint16_t slot, uint32_t target) {
+        prep(4, 0);
+        push<uint32_t>(static_cast<uint32_t>(size() + 4 - target));
+        fields_.push_back({slot, size()});
+    }
+
+    uint32_t endTable() {
+        prep(4, 0);
+        push<int32_t>(0);  // vtable 偏移，稍后回填
+        size_t table = size();
+
+        uint16_t slots = 0;
+        for (const auto& field : fields_) slots = std::max<uint16_t>(slots, field.slot + 1);
+        std::vector<uint16_t> vtable(slots, 0);
+        for (const auto& field : fields_) {
+            vtable[field.slot] = static_cast<uint16_t>(table - field.end);
+        }
+        for (size_t i = vtable.size(); i-- > 0; ) push<uint16_t>(vtable[i]);
+        push<uint16_t>(static_cast<uint16_t>(table - table_start_));
+        push<uint16_t>(static_cast<uint16_t>((slots + 2) * 2));
+
+        int32_t soffset = static_cast<int32_t>(size() - table);
+        std::memcpy(&data_[data_.size() - table], &soffset, sizeof(soffset));
+        return static_cast<uint32_t>(table);
+    }
+
+    std::string finish(uint32_t root) {
+        prep(std::max<size_t>(minalign_, 8), 4);
+        push<uint32_t>(static_cast<uint32_t>(size() + 4 - root));
+        return std::string(reinterpret_cast<const char*>(data_.data() + head_), size());
+    }
+
+private:
+    struct FieldLoc {
+        uint16_t slot;
+        size_t end;
+    };
+
+    // 补零，使写入 additional 字节后总长度按 align 对齐
+    void prep(size_t align, size_t additional) {
+        minalign_ = std::max(minalign_, align);
+        size_t pad = (align - ((size() + additional) & (align - 1))) & (align - 1);
+        if (pad == 0) return;
+        reserve(pad);
+        head_ -= pad;
+        std::memset(&data_[head_], 0, pad);
+    }
+
+    template <typename T>
+    void push(T value) {
+        prepend(&value, sizeof(T));
+    }
+
+    void prepend(const void* bytes, size_t n) {
+        reserve(n);
+        head_ -= n;
+        if (n > 0) std::memcpy(&data_[head_], bytes, n);
+    }
+
+    void reserve(size_t n) {
+        if (head_ >= n) return;
+        size_t used = size();
+        size_t capacity = std::max<size_t>(256, (used + n) * 2);
+        std::vector<uint8_t> grown(capacity);
+        if (used > 0) std::memcpy(&grown[capacity - used], &data_[head_], used);
+        data_.swap(grown);
+        head_ = capacity - used;
+    }
+
+    std::vector<uint8_t> data_;
+    size_t head_ = 0;
+    size_t minalign_ = 1;
+    size_t table_start_ = 0;
+    std::vector<FieldLoc> fields_;
+};
+
+class StreamWriter {
+public:
+    StreamWriter(std::vector<Field> fields, Compression compression, int zstd_level = 1)
+        : fields_(std::move(fields)), compression_(compression), zstd_level_(zstd_level) {}
+
+    // Schema 消息，流的第一条
+    std::string schema() const {
+        FlatBuilder fb;
+        std::vector<uint32_t> fields;
+        for (const Field& field : fields_) {
+            uint32_t name = fb.createString(field.name);
+            uint32_t children = fb.createOffsetVector({});
+            uint8_t type_type = 0;
+            uint32_t type = 0;
+            switch (field.type) {
+            case Type::kUtf8:
+                fb.startTable();
+                type = fb.endTable();
+                type_type = kTypeUtf8;
+                break;
+            case Type::kUInt32:
+            case Type::kInt64:
+                fb.startTable();
+                fb.addScalar<int32_t>(0, field.type == Type::kUInt32 ? 32 : 64);   // bitWidth
+                fb.addScalar<uint8_t>(1, field.type == Type::kInt64);              // is_signed
+                type = fb.endTable();
+                type_type = kTypeInt;
+                break;
+            case Type::kTimestampMs: {
+                uint32_t timezone = fb.createString("UTC");
+                fb.startTable();
+                fb.addScalar<int16_t>(0, kTimeUnitMillisecond);
+                fb.addOffset(1, timezone);
+                type = fb.endTable();
+                type_type = kTypeTimestamp;
+                break;
+            }
+            }
+
+            fb.startTable();
+            fb.addOffset(0, name);
+            fb.addScalar<uint8_t>(1, 0);          // nullable
+            fb.addScalar<uint8_t>(2, type_type);
+            fb.addOffset(3, type);
+            fb.addOffset(5, children);
+            fields.push_back(fb.endTable());
+        }
+        uint32_t field_vector = fb.createOffsetVector(fields);
+
+        fb.startTable();
+        fb.addScalar<int16_t>(0, 0);               // endianness: Little
+        fb.addOffset(1, field_vector);
+        uint32_t schema = fb.endTable();
+        return encapsulate(message(fb, kHeaderSchema, schema, 0), "");
+    }
+
+    // 一个 RecordBatch 消息
+    std::string batch(const BatchBuilder& batch) const {
+        std::string body;
+        std::vector<FieldNode> nodes;
+        std::vector<BufferLoc> buffers;
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            const BatchBuilder::Column& column = batch.columns_[i];
+            nodes.push_back({static_cast<int64_t>(batch.rows()), 0});
+            buffers.push_back({static_cast<int64_t>(body.size()), 0});   // 有效位图，全部非空时为空
+            if (fields_[i].type == Type::kUtf8) {
+                appendBuffer(body, buffers, column.offsets.data(),
+                             column.offsets.size() * sizeof(int32_t));
+            }
+            appendBuffer(body, buffers, column.data.data(), column.data.size());
+        }
+
+        FlatBuilder fb;
+        uint32_t node_vector = fb.createStructVector(nodes);
+        uint32_t buffer_vector = fb.createStructVector(buffers);
+        uint32_t compression = 0;
+        if (compression_ == Compression::kZstd) {
+            fb.startTable();
+            fb.addScalar<int8_t>(0, kCodecZstd);
+            fb.addScalar<int8_t>(1, 0);            // method: BUFFER
+            compression = fb.endTable();
+        }
+        fb.startTable();
+        fb.addScalar<int64_t>(0, static_cast<int64_t>(batch.rows()));
+        fb.addOffset(1, node_vector);
+        fb.addOffset(2, buffer_vector);
+        if (compression != 0) fb.addOffset(3, compression);
+        uint32_t record_batch = fb.endTable();
+        return encapsulate(message(fb, kHeaderRecordBatch, record_batch, body.size()), body);
+    }
+
+    static std::string endOfStream() {
+        return std::string("\xff\xff\xff\xff\0\0\0\0", 8);
+    }
+
+private:
+    static constexpr uint8_t kTypeInt = 2;
+    static constexpr uint8_t kTypeUtf8 = 5;
+    static constexpr uint8_t kTypeTimestamp = 10;
+    static constexpr int16_t kTimeUnitMillisecond = 1;
+    static constexpr uint8_t kHeaderSchema = 1;
+    static constexpr uint8_t kHeaderRecordBatch = 3;
+    static constexpr int16_t kMetadataV5 = 4;
+    static constexpr int8_t kCodecZstd = 1;
+
+    struct FieldNode {
+        int64_t length;
+        int64_t null_count;
+    };
+
+    struct BufferLoc {
+        int64_t offset;
+        int64_t length;
+    };
+
+    static std::string message(FlatBuilder& fb, uint8_t header_type, uint32_t header,
+                               size_t body_length) {
+        fb.startTable();
+        fb.addScalar<int64_t>(3, static_cast<int64_t>(body_length));
+        fb.addOffset(2, header);
+        fb.addScalar<int16_t>(0, kMetadataV5);
+        fb.addScalar<uint8_t>(1, header_type);
+        return fb.finish(fb.endTable());
+    }
+
+    // 续接标记 + 元数据长度 + 元数据（补齐到 8 字节）+ 消息体
+    static std::string encapsulate(std::string metadata, const std::string& body) {
+        metadata.resize((metadata.size() + 7) / 8 * 8, '\0');
+        std::string out("\xff\xff\xff\xff", 4);
+        int32_t length = static_cast<int32_t>(metadata.size());
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out += metadata;
+        out += body;
+        return out;
+    }
+
+    void appendBuffer(std::string& body, std::vector<BufferLoc>& buffers,
+                      const void* data, size_t size) const {
+        size_t offset = body.size();
+        if (compression_ == Compression::kNone || size == 0) {
+            body.append(static_cast<const char*>(data), size);
+        } else {
+            int64_t raw_length = static_cast<int64_t>(size);
+            size_t bound = ZSTD_compressBound(size);
+            body.resize(offset + 8 + bound);
+            size_t compressed = ZSTD_compress(&body[offset + 8], bound, data, size, zstd_level_);
+            if (ZSTD_isError(compressed) || compressed >= size) {
+                raw_length = -1;   // 不值得压缩，原样存放
+                body.resize(offset + 8);
+                body.append(static_cast<const char*>(data), size);
+            } else {
+                body.resize(offset + 8 + compressed);
+            }
+            std::memcpy(&body[offset], &raw_length, sizeof(raw_length));
+        }
+        buffers.push_back({static_cast<int64_t>(offset), static_cast<int64_t>(body.size() - offset)});
+        body.resize((body.size() + 7) / 8 * 8, '\0');
+    }
+
+    std::vector<Field> fields_;
+    Compression compression_;
+    int zstd_level_;
+};
+
+}  // namespace arrow_stream
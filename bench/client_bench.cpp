@@ -0,0 +1,91 @@
+// client_bench.cpp - 客户端 SDK 基准测试
+// 对比逐个心跳、合并心跳、批量心跳、流水线四种方式的吞吐与客户端 CPU 开销
+//
+// 用法: client_bench [host] [port] [sessions] [rounds]
+#include "../online_client.h"
+
+#include <time.h>
+
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+double cpuSeconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double wallSeconds() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 运行一个场景并打印：总操作数、吞吐、每次操作的客户端 CPU 时间
+template <typename Fn>
+void runCase(const char* name, size_t ops, Fn&& fn) {
+    double wall_start = wallSeconds();
+    double cpu_start = cpuSeconds();
+    fn();
+    double wall = wallSeconds() - wall_start;
+    double cpu = cpuSeconds() - cpu_start;
+    std::printf("%-10s ops=%-8zu wall=%.3fs  %10.0f ops/s  client_cpu=%.2f us/op\n",
+                name, ops, wall, ops / wall, cpu * 1e6 / ops);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    online::ClientOptions opts;
+    if (argc > 1) opts.host = argv[1];
+    if (argc > 2) opts.port = std::atoi(argv[2]);
+    size_t sessions = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000;
+    size_t rounds = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 10;
+
+    online::OnlineClient client(opts);
+
+    std::vector<std::string> ids;
+    ids.reserve(sessions);
+    try {
+        for (size_t i = 0; i < sessions; ++i) {
+            ids.push_back(client.login("bench_user_" + std::to_string(i)).session_id);
+        }
+    } catch (const online::ClientError& e) {
+        std::cerr << "login failed: " << e.what() << "\n";
+        return 1;
+    }
+    size_t ops = sessions * rounds;
+
+    runCase("single", ops, [&]() {
+        for (size_t r = 0; r < rounds; ++r) {
+            for (auto& id : ids) client.heartbeat(id);
+        }
+    });
+
+    runCase("async", ops, [&]() {
+        std::vector<std::future<bool>> futures;
+        futures.reserve(sessions);
+        for (size_t r = 0; r < rounds; ++r) {
+            futures.clear();
+            for (auto& id : ids) futures.push_back(client.heartbeatAsync(id));
+            for (auto& f : futures) f.get();
+        }
+    });
+
+    runCase("batch", ops, [&]() {
+        for (size_t r = 0; r < rounds; ++r) client.heartbeatBatch(ids);
+    });
+
+    std::vector<online::HttpCall> calls;
+    calls.reserve(sessions);
+    for (auto& id : ids) {
+        calls.push_back({"POST", "/api/online/heartbeat", online::json{{"session_id", id}}.dump(), true});
+    }
+    runCase("pipeline", ops, [&]() {
+        for (size_t r = 0; r < rounds; ++r) client.pipeline(calls);
+    });
+
+    for (auto& id : ids) client.logout(id);
+    return 0;
+}
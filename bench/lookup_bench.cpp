@@ -0,0 +1,86 @@
+// lookup_bench.cpp - 会话索引批量查找基准测试
+// 对比逐个查找与分组预取批量查找，表大小应远超末级缓存才能体现差异
+//
+// 用法: lookup_bench [sessions] [batch]
+#include "../session_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 与服务端会话槽大小相近，使访存模式接近真实情况
+struct Slot {
+    std::string session_id;
+    std::string user_id;
+    int64_t last_active = 0;
+    std::string room_id;
+};
+
+struct SlotKey {
+    const std::vector<Slot>* slots;
+    const std::string& operator()(uint32_t slot) const { return (*slots)[slot].session_id; }
+};
+
+double nowSeconds() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t sessions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000000;
+    size_t batch = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+    size_t queries = 4000000;
+
+    std::vector<Slot> slots(sessions);
+    SessionIndex<SlotKey> index(SlotKey{&slots}, sessions);
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < sessions; ++i) {
+        slots[i].session_id = "sess_17" + std::to_string(gen() % 100000000000ULL) + "_" + std::to_string(i);
+        slots[i].user_id = "user_" + std::to_string(i);
+        index.insert(slots[i].session_id, static_cast<uint32_t>(i));
+    }
+
+    // 查询 90% 命中、10% 未命中，随机顺序
+    std::vector<std::string> keys;
+    keys.reserve(queries);
+    for (size_t i = 0; i < queries; ++i) {
+        if (gen() % 10 == 0) {
+            keys.push_back("sess_missing_" + std::to_string(gen()));
+        } else {
+            keys.push_back(slots[gen() % sessions].session_id);
+        }
+    }
+    std::vector<uint64_t> hashes(queries);
+    std::vector<uint32_t> out(queries);
+
+    size_t hits = 0;
+    double start = nowSeconds();
+    for (size_t i = 0; i < queries; ++i) {
+        hits += index.find(keys[i]) != SessionIndex<SlotKey>::kNotFound;
+    }
+    double sequential = nowSeconds() - start;
+
+    size_t batch_hits = 0;
+    start = nowSeconds();
+    for (size_t base = 0; base < queries; base += batch) {
+        size_t n = std::min(batch, queries - base);
+        SessionIndex<SlotKey>::hashBatch(&keys[base], n, &hashes[base]);
+        index.findBatch(&keys[base], &hashes[base], n, &out[base]);
+    }
+    for (uint32_t slot : out) batch_hits += slot != SessionIndex<SlotKey>::kNotFound;
+    double batched = nowSeconds() - start;
+
+    std::printf("sessions=%zu queries=%zu batch=%zu group=%zu\n",
+                sessions, queries, batch, SessionIndex<SlotKey>::kGroupSize);
+    std::printf("sequential  %7.1f ns/lookup  hits=%zu\n", sequential * 1e9 / queries, hits);
+    std::printf("prefetched  %7.1f ns/lookup  hits=%zu  speedup=%.2fx\n",
+                batched * 1e9 / queries, batch_hits, sequential / batched);
+    return hits == batch_hits ? 0 : 1;
+}
@@ -0,0 +1,547 @@
+// perf_gate.cpp - 性能回归门禁
+// 进程内直接驱动 OnlineManager 的每个操作和每个 HTTP 接口（经 Router 分发，不走网络），
+// 每个场景重复多轮，输出吞吐、p50/p99/p999 延迟和每次操作的内存分配次数（JSON），
+// 并与仓库里的基线比较：
+//   - 每个指标取各轮中位数，噪声用各轮的相对 MAD 估计
+//   - 先按校准负载的耗时之比把基线换算到本次机器的速度，抵消整体快慢差异
+//   - 退化超过 max(该指标容忍度, 3 × 合并噪声) 判为回归；噪声只用来放宽阈值，放宽最多到容忍度的 2 倍，
+//     几轮里碰巧抖得厉害也不会让门禁形同虚设。分配次数按次数差比较
+//   - 计时线程绑定在启动时所在的 CPU 上，避免迁移带来的缓存冷启动
+//   - 样本不足的高分位数只报告不判定
+//   - 基线里有但本次没有的场景、没有场景覆盖的路由也算失败
+// 有回归时在 stderr 打印 PERF REGRESSION 并以 1 退出。
+// 基线与机器强相关，需在门禁机器上生成：perf_gate - bench/perf_baseline.json
+//
+// 用法: perf_gate [baseline|-] [results] [sessions] [ops] [repeats]
+#define ONLINE_SERVER_NO_MAIN
+#include "../server.cpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstdio>
+#include <new>
+
+namespace {
+
+// 本线程的堆分配次数；只统计基准线程，清理线程等后台分配不计入
+thread_local uint64_t g_allocs = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+    ++g_allocs;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 一个基准场景：prepare/finish 不计时，run(i) 为第 i 次操作
+struct Case {
+    std::string name;
+    size_t cost = 1;                            // 相对开销，单轮操作数为 ops / cost
+    std::function<void(size_t ops)> prepare;
+    std::function<void(size_t i)> run;
+    std::function<void()> finish;
+};
+
+// 一轮的结果
+struct Sample {
+    double ops_per_sec = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+};
+
+struct Thresholds {
+    double ops_per_sec = 0.10;   // 吞吐下降比例
+    double p50_ns = 0.20;        // 延迟上升比例
+    double p99_ns = 0.30;
+    double p999_ns = 1.00;
+    double allocs = 0.5;         // 每次操作多出的分配次数
+    double allocs_ratio = 0.02;  // 再加上基线的这一比例（响应大小随数据变化会带来零星的扩容）
+    double noise_k = 3.0;        // 阈值至少为合并噪声的倍数
+    double noise_cap = 2.0;      // 噪声放宽的上限，为该指标容忍度的倍数
+};
+
+const char* const kMetrics[] = {"ops_per_sec", "p50_ns", "p99_ns", "p999_ns"};
+// 样本太少时高分位数基本等于最大值，只报告不判定
+const size_t kMinSamples[] = {0, 0, 1000, 10000};
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// 相对噪声：1.4826 × MAD / 中位数，近似正态分布下的相对标准差
+double relativeNoise(const std::vector<double>& values, double mid) {
+    if (values.size() < 2 || mid <= 0) return 0;
+    std::vector<double> deviations;
+    for (double v : values) deviations.push_back(std::fabs(v - mid));
+    return 1.4826 * median(deviations) / mid;
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double q) {
+    size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return static_cast<double>(sorted[index]);
+}
+
+// 场景各轮的原始结果
+struct CaseResult {
+    size_t ops = 0;
+    uint64_t allocs = 0;
+    std::vector<Sample> rounds;
+    std::vector<double> calibration;   // 每轮开始前的校准耗时
+};
+
+// 校准负载：固定的字符串哈希表查找，与被测代码无关，返回每次查找的纳秒数（取三次最小值）。
+// 每轮场景前测一次，按它与全程中位数的比值修正该轮的时间，
+// 抵消 CPU 降频、宿主机争用等对所有场景同时生效的漂移
+double calibrate() {
+    static std::vector<std::string> keys;
+    static std::unordered_map<std::string, uint32_t> table;
+    if (keys.empty()) {
+        std::mt19937_64 gen(7);
+        for (uint32_t i = 0; i < 4096; ++i) {
+            keys.push_back("calibration_" + std::to_string(gen()));
+            table.emplace(keys.back(), i);
+        }
+    }
+    double best = 1e18;
+    for (int rep = 0; rep < 3; ++rep) {
+        uint64_t sum = 0;
+        auto start = Clock::now();
+        for (size_t i = 0; i < 16384; ++i) sum += table.find(keys[(i * 2654435761u) % keys.size()])->second;
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / 16384;
+        if (sum != 0) best = std::min(best, ns);
+    }
+    return best;
+}
+
+// 跑一轮：prepare、计时执行 n 次、finish
+void runRound(Case& c, CaseResult& result, bool record) {
+    size_t n = result.ops;
+    std::vector<uint64_t> latencies(n);
+    double calibration = calibrate();
+    if (c.prepare) c.prepare(n);
+    uint64_t allocs_start = g_allocs;
+    auto start = Clock::now();
+    auto last = start;
+    for (size_t i = 0; i < n; ++i) {
+        c.run(i);
+        auto now = Clock::now();
+        latencies[i] = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+        last = now;
+    }
+    double seconds = std::chrono::duration<double>(last - start).count();
+    uint64_t allocs = g_allocs - allocs_start;
+    if (c.finish) c.finish();
+    if (!record) return;
+
+    std::sort(latencies.begin(), latencies.end());
+    result.allocs += allocs;
+    result.calibration.push_back(calibration);
+    result.rounds.push_back({n / seconds, percentile(latencies, 0.50), percentile(latencies, 0.99),
+                             percentile(latencies, 0.999)});
+}
+
+// 按校准值修正各轮结果，取中位数和噪声
+json summarize(const CaseResult& result, double reference) {
+    std::vector<double> metrics[4];
+    for (size_t r = 0; r < result.rounds.size(); ++r) {
+        double speed = result.calibration[r] / reference;   // >1 表示这一轮机器偏慢
+        const Sample& s = result.rounds[r];
+        metrics[0].push_back(s.ops_per_sec * speed);
+        metrics[1].push_back(s.p50_ns / speed);
+        metrics[2].push_back(s.p99_ns / speed);
+        metrics[3].push_back(s.p999_ns / speed);
+    }
+    json summary = {
+        {"ops", result.ops},
+        {"allocs_per_op", static_cast<double>(result.allocs) / (result.ops * result.rounds.size())}
+    };
+    json noise = json::object();
+    for (size_t m = 0; m < 4; ++m) {
+        double mid = median(metrics[m]);
+        summary[kMetrics[m]] = mid;
+        noise[kMetrics[m]] = relativeNoise(metrics[m], mid);
+    }
+    summary["noise"] = noise;
+    return summary;
+}
+
+// 与基线比较，打印每个场景的结论，返回回归数
+size_t compare(const json& baseline, const json& results, const Thresholds& t) {
+    size_t regressions = 0;
+    const json& base_cases = baseline["cases"];
+    const json& cur_cases = results["cases"];
+    // 两次运行的校准值之比即机器整体快慢之比，先把基线换算到本次的速度上
+    double speed = 1.0;
+    double base_calibration = baseline.value("calibration_ns", 0.0);
+    double cur_calibration = results.value("calibration_ns", 0.0);
+    if (base_calibration > 0 && cur_calibration > 0) speed = cur_calibration / base_calibration;
+    std::printf("calibration %.2f ns -> %.2f ns, baseline scaled by %.3f\n",
+                base_calibration, cur_calibration, speed);
+    for (auto it = base_cases.begin(); it != base_cases.end(); ++it) {
+        if (!cur_cases.contains(it.key())) {
+            std::fprintf(stderr, "PERF REGRESSION %s: case missing from this run\n", it.key().c_str());
+            ++regressions;
+        }
+    }
+    for (auto it = cur_cases.begin(); it != cur_cases.end(); ++it) {
+        const std::string& name = it.key();
+        const json& cur = it.value();
+        if (!base_cases.contains(name)) {
+            std::printf("%-40s new case, not in baseline\n", name.c_str());
+            continue;
+        }
+        const json& base = base_cases[name];
+        const double limits[] = {t.ops_per_sec, t.p50_ns, t.p99_ns, t.p999_ns};
+        std::string verdict;
+        for (size_t m = 0; m < 4; ++m) {
+            const char* metric = kMetrics[m];
+            double b = m == 0 ? base.value(metric, 0.0) / speed : base.value(metric, 0.0) * speed;
+            double c = cur.value(metric, 0.0);
+            if (b <= 0 || c <= 0 || cur.value("ops", size_t(0)) < kMinSamples[m]) continue;
+            double noise = std::hypot(base["noise"].value(metric, 0.0), cur["noise"].value(metric, 0.0));
+            double allowed = std::min(std::max(limits[m], t.noise_k * noise), t.noise_cap * limits[m]);
+            // 吞吐越高越好，延迟越低越好，统一成“变差的比例”
+            double worse = m == 0 ? (b - c) / b : (c - b) / b;
+            if (worse > allowed) {
+                char line[160];
+                std::snprintf(line, sizeof(line), " %s %.4g -> %.4g (%+.1f%%, allowed %.1f%%)",
+                              metric, b, c, (c - b) * 100 / b, allowed * 100);
+                verdict += line;
+            }
+        }
+        double base_allocs = base.value("allocs_per_op", 0.0);
+        double cur_allocs = cur.value("allocs_per_op", 0.0);
+        if (cur_allocs - base_allocs > t.allocs + base_allocs * t.allocs_ratio) {
+            char line[160];
+            std::snprintf(line, sizeof(line), " allocs_per_op %.2f -> %.2f", base_allocs, cur_allocs);
+            verdict += line;
+        }
+        if (verdict.empty()) {
+            std::printf("%-40s ok\n", name.c_str());
+        } else {
+            std::fprintf(stderr, "PERF REGRESSION %s:%s\n", name.c_str(), verdict.c_str());
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+Thresholds thresholdsFrom(const json& baseline) {
+    Thresholds t;
+    if (!baseline.is_object() || !baseline.contains("thresholds")) return t;
+    const json& j = baseline["thresholds"];
+    t.ops_per_sec = j.value("ops_per_sec", t.ops_per_sec);
+    t.p50_ns = j.value("p50_ns", t.p50_ns);
+    t.p99_ns = j.value("p99_ns", t.p99_ns);
+    t.p999_ns = j.value("p999_ns", t.p999_ns);
+    t.allocs = j.value("allocs_per_op", t.allocs);
+    t.allocs_ratio = j.value("allocs_ratio", t.allocs_ratio);
+    t.noise_k = j.value("noise_k", t.noise_k);
+    t.noise_cap = j.value("noise_cap", t.noise_cap);
+    return t;
+}
+
+json thresholdsJson(const Thresholds& t) {
+    return {{"ops_per_sec", t.ops_per_sec}, {"p50_ns", t.p50_ns}, {"p99_ns", t.p99_ns},
+            {"p999_ns", t.p999_ns}, {"allocs_per_op", t.allocs}, {"allocs_ratio", t.allocs_ratio}, {"noise_k", t.noise_k},
+            {"noise_cap", t.noise_cap}};
+}
+
+httplib::Request makeRequest(const std::string& method, const std::string& path,
+                             const std::string& body = "") {
+    httplib::Request req;
+    req.method = method;
+    req.path = path;
+    req.body = body;
+    req.remote_addr = "10.1.2.3";
+    return req;
+}
+
+// 驱动分块响应直到结束，与 httplib 写出流式响应的方式一致
+void drainContent(httplib::Response& res) {
+    if (!res.content_provider_) return;
+    bool done = false;
+    size_t offset = 0;
+    httplib::DataSink sink;
+    sink.write = [&offset](const char*, size_t n) {
+        offset += n;
+        return true;
+    };
+    sink.is_writable = []() { return true; };
+    sink.done = [&done]() { done = true; };
+    while (!done && res.content_provider_(offset, 0, sink)) {
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string baseline_file = argc > 1 ? argv[1] : "bench/perf_baseline.json";
+    std::string results_file = argc > 2 ? argv[2] : "perf_results.json";
+    size_t sessions = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20000;
+    size_t ops = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 20000;
+    size_t repeats = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 9;
+    if (sessions == 0 || ops == 0 || repeats == 0) {
+        std::cerr << "usage: perf_gate [baseline|-] [results] [sessions] [ops] [repeats]\n";
+        return 2;
+    }
+
+    // 先读基线，读不到就不必跑了；阈值跟随基线文件，结果文件原样带上便于直接替换基线
+    json baseline;
+    if (baseline_file != "-") {
+        std::ifstream in(baseline_file);
+        baseline = json::parse(in, nullptr, false);
+        if (baseline.is_discarded() || !baseline.contains("cases")) {
+            std::cerr << "cannot read baseline " << baseline_file << "\n";
+            return 2;
+        }
+        // 会话规模和操作数不同，结果不可比
+        const json& recorded = baseline.value("config", json::object());
+        if (recorded.value("sessions", sessions) != sessions || recorded.value("ops", ops) != ops) {
+            std::cerr << "baseline " << baseline_file << " was recorded with sessions="
+                      << recorded.value("sessions", sessions) << " ops=" << recorded.value("ops", ops) << "\n";
+            return 2;
+        }
+    }
+    Thresholds thresholds = thresholdsFrom(baseline);
+
+    OnlineConfig config;
+    config.shm_name.clear();
+    OnlineManager manager(config);
+    Router router;
+    registerRoutes(router, manager, "perf-gate");
+
+    // 固定种子的在线人口：房间、平台、版本、IP、坐标均匀分布
+    std::mt19937_64 gen(42);
+    const std::vector<std::string> platforms = {"ios", "android", "web"};
+    std::vector<std::string> ids;
+    std::vector<std::string> users;
+    for (size_t i = 0; i < sessions; ++i) {
+        users.push_back("user_" + std::to_string(i));
+        GeoPoint location{31.0 + (gen() % 10000) / 10000.0, 121.0 + (gen() % 10000) / 10000.0};
+        ClientInfo client{"10.0." + std::to_string(i / 256 % 256) + "." + std::to_string(i % 256),
+                          platforms[i % platforms.size()], "2." + std::to_string(i % 8) + ".0"};
+        ids.push_back(manager.userLogin(users.back(), location, "room_" + std::to_string(i % 100), client));
+    }
+    auto pickId = [&]() -> const std::string& { return ids[gen() % ids.size()]; };
+    auto pickIds = [&](size_t n) {
+        std::vector<std::string> batch;
+        for (size_t i = 0; i < n; ++i) batch.push_back(pickId());
+        return batch;
+    };
+
+    std::vector<Case> cases;
+    std::vector<std::string> scratch;          // 登录/退出场景本轮涉及的会话
+    std::vector<std::vector<std::string>> batches;
+
+    // OnlineManager 的每个公开操作
+    cases.push_back({"manager.login", 1,
+        [&](size_t) { scratch.clear(); },
+        [&](size_t i) { scratch.push_back(manager.userLogin("bench_" + std::to_string(i))); },
+        [&]() { for (auto& id : scratch) manager.userLogout(id); }});
+    cases.push_back({"manager.logout", 1,
+        [&](size_t n) {
+            scratch.clear();
+            for (size_t i = 0; i < n; ++i) scratch.push_back(manager.userLogin("bench_" + std::to_string(i)));
+        },
+        [&](size_t i) { manager.userLogout(scratch[i]); }, nullptr});
+    cases.push_back({"manager.heartbeat", 1, nullptr,
+        [&](size_t) { manager.userHeartbeat(pickId()); }, nullptr});
+    cases.push_back({"manager.heartbeat_batch64", 64,
+        [&](size_t n) { batches.clear(); for (size_t i = 0; i < n; ++i) batches.push_back(pickIds(64)); },
+        [&](size_t i) { manager.userHeartbeatBatch(batches[i]); }, nullptr});
+    cases.push_back({"manager.validate", 1, nullptr,
+        [&](size_t) { manager.isValidSession(pickId()); }, nullptr});
+    cases.push_back({"manager.validate_batch64", 64,
+        [&](size_t n) { batches.clear(); for (size_t i = 0; i < n; ++i) batches.push_back(pickIds(64)); },
+        [&](size_t i) { manager.validateBatch(batches[i]); }, nullptr});
+    cases.push_back({"manager.filter_sessions64", 64,
+        [&](size_t n) { batches.clear(); for (size_t i = 0; i < n; ++i) batches.push_back(pickIds(64)); },
+        [&](size_t i) { manager.filterSessions(batches[i]); }, nullptr});
+    cases.push_back({"manager.move_room", 1, nullptr,
+        [&](size_t i) { manager.moveRoom(pickId(), "room_" + std::to_string(i % 100)); }, nullptr});
+    cases.push_back({"manager.room_count", 1, nullptr,
+        [&](size_t i) { manager.getRoomCount("room_" + std::to_string(i % 100)); }, nullptr});
+    cases.push_back({"manager.room_users", 20, nullptr,
+        [&](size_t i) { manager.getRoomUsers("room_" + std::to_string(i % 100)); }, nullptr});
+    cases.push_back({"manager.online_count", 1, nullptr,
+        [&](size_t) { manager.getOnlineCount(); }, nullptr});
+    cases.push_back({"manager.online_users", 1000, nullptr,
+        [&](size_t) { manager.getOnlineUsers(); }, nullptr});
+    cases.push_back({"manager.recent_users50", 10, nullptr,
+        [&](size_t) { manager.getRecentUsers(50); }, nullptr});
+    cases.push_back({"manager.last_seen", 1, nullptr,
+        [&](size_t i) { manager.getLastSeen({users[i % users.size()]}); }, nullptr});
+    cases.push_back({"manager.activity_stats", 50, nullptr,
+        [&](size_t) { manager.getActivityStats(); }, nullptr});
+    cases.push_back({"manager.nearby_k20", 10, nullptr,
+        [&](size_t i) { manager.getNearby({31.5, 121.0 + (i % 100) / 100.0}, 2000, 20, 0); }, nullptr});
+    cases.push_back({"manager.query_sessions", 100, nullptr,
+        [&](size_t) { manager.querySessions(SessionMetaTable::Filter(), "ios", 100); }, nullptr});
+    cases.push_back({"manager.export_sessions", 2000, nullptr,
+        [&](size_t) {
+            arrow_stream::BatchBuilder batch(OnlineManager::exportSchema());
+            uint32_t cursor = 0;
+            while (manager.exportSessions(cursor, 8192, batch)) batch.clear();
+        }, nullptr});
+
+    // 每个 HTTP 接口：请求在 prepare 里构造好，计时只包含分发和处理
+    std::vector<httplib::Request> requests;
+    auto endpoint = [&](const std::string& method, const std::string& path, size_t cost,
+                        std::function<httplib::Request(size_t)> make,
+                        std::function<void()> finish = nullptr) {
+        cases.push_back({method + " " + path, cost,
+            [&, make](size_t n) {
+                requests.clear();
+                scratch.clear();
+                for (size_t i = 0; i < n; ++i) requests.push_back(make(i));
+            },
+            [&, finish](size_t i) {
+                httplib::Response res;
+                router.dispatch(requests[i], res);
+                drainContent(res);
+                if (!finish) return;
+                scratch.push_back(std::move(res.body));
+            },
+            [&, finish]() {
+                if (finish) finish();
+                scratch.clear();
+            }});
+    };
+    auto get = [&](const std::string& path, httplib::Params params) {
+        return [path, params](size_t) {
+            httplib::Request req = makeRequest("GET", path);
+            req.params = params;
+            if (path.compare(0, 11, "/api/admin/") == 0) req.headers.emplace("Authorization", "Bearer perf-gate");
+            return req;
+        };
+    };
+    auto post = [&](const std::string& path, std::function<json(size_t)> body) {
+        return [path, body](size_t i) { return makeRequest("POST", path, body(i).dump()); };
+    };
+    auto session = [&](size_t) { return json{{"session_id", pickId()}}; };
+    auto batch64 = [&](size_t) { return json{{"session_ids", pickIds(64)}}; };
+
+    // 登录接口的响应体暂存在 scratch，结束后取出会话ID退出
+    endpoint("POST", "/api/online/login", 1,
+        post("/api/online/login", [](size_t i) {
+            return json{{"user_id", "bench_" + std::to_string(i)}, {"platform", "ios"}, {"app_version", "2.1.0"}};
+        }),
+        [&]() {
+            for (auto& body : scratch) {
+                manager.userLogout(json::parse(body).value("/data/session_id"_json_pointer, std::string()));
+            }
+        });
+    endpoint("POST", "/api/online/logout", 1, [&](size_t i) {
+        return makeRequest("POST", "/api/online/logout",
+                           json{{"session_id", manager.userLogin("bench_" + std::to_string(i))}}.dump());
+    });
+    endpoint("POST", "/api/online/heartbeat", 1, post("/api/online/heartbeat", session));
+    endpoint("POST", "/api/online/heartbeat/batch", 64, post("/api/online/heartbeat/batch", batch64));
+    endpoint("POST", "/api/online/validate", 1, post("/api/online/validate", session));
+    endpoint("POST", "/api/online/validate/batch", 64, post("/api/online/validate/batch", batch64));
+    endpoint("POST", "/api/online/sessions/filter", 64, post("/api/online/sessions/filter", batch64));
+    endpoint("POST", "/api/online/room/move", 1, post("/api/online/room/move", [&](size_t i) {
+        return json{{"session_id", pickId()}, {"room_id", "room_" + std::to_string(i % 100)}};
+    }));
+    endpoint("GET", "/api/online/room/count", 1, get("/api/online/room/count", {{"room_id", "room_7"}}));
+    endpoint("GET", "/api/online/room/users", 20, get("/api/online/room/users", {{"room_id", "room_7"}}));
+    endpoint("GET", "/api/online/count", 1, get("/api/online/count", {}));
+    endpoint("GET", "/api/online/users", 1000, get("/api/online/users", {}));
+    endpoint("GET", "/api/online/users/recent", 10, get("/api/online/users/recent", {{"k", "50"}}));
+    endpoint("GET", "/api/online/active", 50, get("/api/online/active", {}));
+    endpoint("GET", "/api/online/lastseen", 1, get("/api/online/lastseen", {{"user_id", "user_1"}}));
+    endpoint("POST", "/api/online/lastseen/batch", 64, post("/api/online/lastseen/batch", [&](size_t i) {
+        std::vector<std::string> batch;
+        for (size_t j = 0; j < 64; ++j) batch.push_back(users[(i * 64 + j) % users.size()]);
+        return json{{"user_ids", batch}};
+    }));
+    endpoint("GET", "/api/online/nearby", 10,
+             get("/api/online/nearby", {{"lat", "31.5"}, {"lon", "121.5"}, {"radius", "2000"}, {"k", "20"}}));
+    endpoint("GET", "/api/admin/sessions", 100,
+             get("/api/admin/sessions", {{"platform", "ios"}, {"limit", "100"}}));
+    endpoint("GET", "/api/admin/export", 2000, get("/api/admin/export", {}));
+    endpoint("GET", "/api/health", 1, get("/api/health", {}));
+    endpoint("GET", "/metrics", 10, get("/metrics", {}));
+
+    // 每个路由都必须有场景；/debug/profile 会阻塞采样、首页是静态页面，不参与
+    size_t uncovered = 0;
+    for (const auto& route : router.routes()) {
+        std::string name = route.method + " " + route.path;
+        if (route.path == "/debug/profile" || route.path == "/") continue;
+        bool covered = std::any_of(cases.begin(), cases.end(), [&](const Case& c) { return c.name == name; });
+        if (!covered) {
+            std::fprintf(stderr, "PERF REGRESSION %s: route has no benchmark case\n", name.c_str());
+            ++uncovered;
+        }
+    }
+
+    // 只绑定计时线程，清理线程等已经启动的后台线程不受影响
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    // 各场景轮流执行，多轮交错，使整体漂移在各场景之间均摊；第 0 轮预热不计入
+    std::vector<CaseResult> raw(cases.size());
+    for (size_t i = 0; i < cases.size(); ++i) raw[i].ops = std::max<size_t>(ops / cases[i].cost, 50);
+    for (size_t round = 0; round <= repeats; ++round) {
+        for (size_t i = 0; i < cases.size(); ++i) {
+            // 刷新一遍心跳，避免长时间运行后会话过期
+            manager.userHeartbeatBatch(ids);
+            runRound(cases[i], raw[i], round > 0);
+        }
+    }
+
+    std::vector<double> calibrations;
+    for (auto& r : raw) calibrations.insert(calibrations.end(), r.calibration.begin(), r.calibration.end());
+    double reference = median(calibrations);
+    json results = {
+        {"config", {{"sessions", sessions}, {"ops", ops}, {"repeats", repeats}}},
+        {"calibration_ns", reference},
+        {"thresholds", thresholdsJson(thresholds)},
+        {"cases", json::object()}
+    };
+    std::printf("%-40s %10s %12s %10s %10s %10s %8s\n",
+                "case", "ops", "ops/s", "p50(ns)", "p99(ns)", "p999(ns)", "allocs");
+    for (size_t i = 0; i < cases.size(); ++i) {
+        json r = summarize(raw[i], reference);
+        std::printf("%-40s %10zu %12.0f %10.0f %10.0f %10.0f %8.2f\n", cases[i].name.c_str(),
+                    r["ops"].get<size_t>(), r["ops_per_sec"].get<double>(), r["p50_ns"].get<double>(),
+                    r["p99_ns"].get<double>(), r["p999_ns"].get<double>(), r["allocs_per_op"].get<double>());
+        results["cases"][cases[i].name] = r;
+    }
+
+    std::ofstream out(results_file);
+    out << results.dump(2) << "\n";
+    if (!out) {
+        std::cerr << "cannot write " << results_file << "\n";
+        return 2;
+    }
+
+    if (baseline_file == "-") return uncovered > 0 ? 1 : 0;
+    size_t regressions = compare(baseline, results, thresholds) + uncovered;
+    if (regressions > 0) {
+        std::fprintf(stderr, "PERF REGRESSION: %zu case(s) regressed against %s\n",
+                     regressions, baseline_file.c_str());
+        return 1;
+    }
+    std::printf("no regressions against %s\n", baseline_file.c_str());
+    return 0;
+}
@@ -0,0 +1,44 @@
+// session_meta_test.cpp - 会话元数据平台字典检查
+// 用大量不同的平台名登录（平台名来自客户端请求体，不可信），确认字典写满后新平台归入 "other"，
+// 登录不会崩溃，按平台查询的结果与登录时一致。结果不一致时返回 1。
+//
+// 用法: session_meta_test [platforms]
+#define ONLINE_SERVER_NO_MAIN
+#include "../server.cpp"
+
+#include <cstdio>
+
+int main(int argc, char** argv) {
+    size_t platforms = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 300;
+
+    OnlineConfig config;
+    config.shm_name.clear();
+    OnlineManager manager(config);
+    for (size_t i = 0; i < platforms; ++i) {
+        manager.userLogin("user_" + std::to_string(i), std::nullopt, "",
+                          {"10.0.0.1", "platform_" + std::to_string(i), "1.0.0"});
+    }
+
+    // 编码 0 为空平台、1 为 "other"，其余 253 个编码按登录顺序分配
+    size_t named = std::min<size_t>(platforms, 253);
+    size_t failures = 0;
+    for (size_t i = 0; i < platforms; ++i) {
+        std::string name = "platform_" + std::to_string(i);
+        auto query = manager.querySessions(SessionMetaTable::Filter(), name, 10);
+        size_t expected = i < named ? 1 : 0;
+        if (query.total != expected ||
+            (expected == 1 && query.sessions[0].platform != name)) {
+            std::fprintf(stderr, "%s: %zu sessions, expected %zu\n", name.c_str(), query.total, expected);
+            ++failures;
+        }
+    }
+    auto other = manager.querySessions(SessionMetaTable::Filter(), "other", platforms);
+    if (other.total != platforms - named) {
+        std::fprintf(stderr, "other: %zu sessions, expected %zu\n", other.total, platforms - named);
+        ++failures;
+    }
+
+    std::printf("%zu platforms, %zu named, %zu as other, %zu failures\n",
+                platforms, named, other.total, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// spatial_test.cpp - 空间索引正确性与极区查询耗时检查
+// 随机撒点（含两极附近和 ±180 经线附近），与暴力扫描的结果逐条比对；
+// 再单独测靠近极点的大半径查询，这类查询的外接矩形覆盖整圈经度，不能逐格扫描。
+// 结果不一致时返回 1。
+//
+// 用法: spatial_test [sessions] [queries]
+#include "../spatial_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Point {
+    std::string session_id;
+    std::string user_id;
+    GeoPoint point;
+};
+
+// 暴力扫描，语义与 withinRadius 相同：按用户去重保留最近的会话，按距离升序
+std::vector<SpatialIndex::Hit> bruteForce(const std::vector<Point>& points, const GeoPoint& center,
+                                          double radius_m, size_t limit) {
+    std::vector<SpatialIndex::Hit> hits;
+    std::unordered_map<std::string, size_t> by_user;
+    for (const auto& p : points) {
+        double d = SpatialIndex::distanceMeters(center, p.point);
+        if (d > radius_m) continue;
+        auto seen = by_user.find(p.user_id);
+        if (seen != by_user.end()) {
+            if (d < hits[seen->second].distance_m) hits[seen->second] = {p.user_id, p.session_id, d};
+            continue;
+        }
+        by_user.emplace(p.user_id, hits.size());
+        hits.push_back({p.user_id, p.session_id, d});
+    }
+    std::sort(hits.begin(), hits.end(),
+              [](const SpatialIndex::Hit& a, const SpatialIndex::Hit& b) { return a.distance_m < b.distance_m; });
+    if (hits.size() > limit) hits.resize(limit);
+    return hits;
+}
+
+// 只比较距离：距离相同的两个会话先后顺序不固定
+bool sameHits(const std::vector<SpatialIndex::Hit>& a, const std::vector<SpatialIndex::Hit>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::abs(a[i].distance_m - b[i].distance_m) > 1e-6) return false;
+    }
+    return true;
+}
+
+GeoPoint randomPoint(std::mt19937_64& rng) {
+    std::uniform_real_distribution<double> lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+    std::uniform_real_distribution<double> offset(0.0, 2.0);
+    switch (rng() % 4) {
+        case 0: return {90.0 - offset(rng), lon(rng)};                  // 北极附近
+        case 1: return {-90.0 + offset(rng), lon(rng)};                 // 南极附近
+        case 2: return {lat(rng), (rng() % 2 ? 180.0 : -178.0) - offset(rng)};  // ±180 经线附近
+        default: return {lat(rng), lon(rng)};
+    }
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t sessions = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    size_t queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500;
+
+    std::mt19937_64 rng(42);
+    SpatialIndex index;
+    std::vector<Point> points;
+    points.reserve(sessions);
+    for (size_t i = 0; i < sessions; ++i) {
+        // 约一半用户有两个会话，覆盖按用户去重
+        points.push_back({"s" + std::to_string(i), "u" + std::to_string(i / 2 + (i % 3 == 0 ? i : 0)),
+                          randomPoint(rng)});
+        index.update(points.back().session_id, points.back().user_id, points.back().point);
+    }
+
+    const double radii[] = {500.0, 20000.0, 100000.0, 1000000.0};
+    size_t failures = 0;
+    for (size_t q = 0; q < queries; ++q) {
+        GeoPoint center = randomPoint(rng);
+        double radius = radii[q % 4];
+        if (!sameHits(index.withinRadius(center, radius, 50), bruteForce(points, center, radius, 50))) {
+            std::fprintf(stderr, "withinRadius mismatch at (%.4f, %.4f) r=%.0f\n", center.lat, center.lon, radius);
+            ++failures;
+        }
+        if (!sameHits(index.nearest(center, 20, radius), bruteForce(points, center, radius, 20))) {
+            std::fprintf(stderr, "nearest mismatch at (%.4f, %.4f) r=%.0f\n", center.lat, center.lon, radius);
+            ++failures;
+        }
+    }
+
+    // 极点附近的大半径查询：外接矩形覆盖整圈经度（每行 36000 个格子）
+    const GeoPoint pole_centers[] = {{89.5, 0.0}, {90.0, 45.0}, {-89.9, -179.9}};
+    for (const GeoPoint& center : pole_centers) {
+        auto start = std::chrono::steady_clock::now();
+        auto within = index.withinRadius(center, 100000, 100);
+        double within_ms = elapsedMs(start);
+        start = std::chrono::steady_clock::now();
+        auto knn = index.nearest(center, 20, 100000);
+        double knn_ms = elapsedMs(start);
+        bool ok = sameHits(within, bruteForce(points, center, 100000, 100)) &&
+                  sameHits(knn, bruteForce(points, center, 100000, 20));
+        if (!ok) ++failures;
+        std::printf("pole (%.1f, %.1f) r=100km  within %.3f ms (%zu hits)  k20 %.3f ms  %s\n",
+                    center.lat, center.lon, within_ms, within.size(), knn_ms, ok ? "ok" : "MISMATCH");
+    }
+
+    std::printf("%zu sessions, %zu queries, %zu failures\n", sessions, queries, failures);
+    return failures == 0 ? 0 : 1;
+}
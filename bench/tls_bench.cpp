@@ -0,0 +1,247 @@
+// tls_bench.cpp - TLS 监听基准测试
+// 模拟心跳客户端，测量：
+//   full      每次新建连接完整握手 + 一次心跳 + 断开
+//   resumed   同上，但携带上次的会话票据恢复会话（统计实际恢复比例）
+//   keepalive 单条 TLS 长连接上连续心跳，稳态每次心跳的开销
+//   plain     单条明文长连接上连续心跳，作为 keepalive 的对照（plain_port 为 0 时跳过）
+// 客户端 CPU 时间包含在输出中，服务端开销请结合 /debug/profile 查看。
+//
+// 用法: tls_bench [host] [tls_port] [plain_port] [connections] [heartbeats]
+#include <nlohmann/json.hpp>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using json = nlohmann::json;
+
+double cpuSeconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double wallSeconds() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Fn>
+void runCase(const char* name, size_t ops, Fn&& fn) {
+    double wall_start = wallSeconds();
+    double cpu_start = cpuSeconds();
+    fn();
+    double wall = wallSeconds() - wall_start;
+    double cpu = cpuSeconds() - cpu_start;
+    std::printf("%-10s ops=%-8zu wall=%.3fs  %10.0f ops/s  client_cpu=%.2f us/op\n",
+                name, ops, wall, ops / wall, cpu * 1e6 / ops);
+}
+
+int connectTcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+// 一条连接，TLS 或明文，只实现基准需要的最小 HTTP/1.1
+class Connection {
+public:
+    Connection(SSL_CTX* ctx, const std::string& host, int port, SSL_SESSION* session = nullptr) {
+        fd_ = connectTcp(host, port);
+        if (fd_ < 0 || ctx == nullptr) return;
+        ssl_ = SSL_new(ctx);
+        SSL_set_fd(ssl_, fd_);
+        SSL_set_tlsext_host_name(ssl_, host.c_str());
+        if (session != nullptr) SSL_set_session(ssl_, session);
+        if (SSL_connect(ssl_) != 1) {
+            ERR_print_errors_fp(stderr);
+            SSL_free(ssl_);
+            ssl_ = nullptr;
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    ~Connection() {
+        if (ssl_ != nullptr) {
+            SSL_shutdown(ssl_);
+            SSL_free(ssl_);
+        }
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+    bool reused() const { return ssl_ != nullptr && SSL_session_reused(ssl_); }
+
+    // 收到响应后才能拿到 TLS 1.3 的会话票据
+    SSL_SESSION* session() const { return ssl_ != nullptr ? SSL_get1_session(ssl_) : nullptr; }
+
+    bool post(const std::string& path, const std::string& body, std::string& response) {
+        std::string req = "POST " + path + " HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n"
+                          "Content-Type: application/json\r\nContent-Length: " +
+                          std::to_string(body.size()) + "\r\n\r\n" + body;
+        if (!writeAll(req)) return false;
+
+        // 读到头部结束，再按 Content-Length 读响应体
+        size_t header_end;
+        while ((header_end = buf_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) return false;
+        }
+        size_t length = 0;
+        auto pos = buf_.find("Content-Length:");
+        if (pos == std::string::npos) pos = buf_.find("content-length:");
+        if (pos != std::string::npos && pos < header_end) {
+            length = std::strtoul(buf_.c_str() + pos + 15, nullptr, 10);
+        }
+        while (buf_.size() < header_end + 4 + length) {
+            if (!fill()) return false;
+        }
+        response = buf_.substr(header_end + 4, length);
+        buf_.erase(0, header_end + 4 + length);
+        return true;
+    }
+
+private:
+    bool writeAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int n = ssl_ != nullptr
+                ? SSL_write(ssl_, data.data() + sent, static_cast<int>(data.size() - sent))
+                : static_cast<int>(::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL));
+            if (n <= 0) return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool fill() {
+        char tmp[16384];
+        int n = ssl_ != nullptr ? SSL_read(ssl_, tmp, sizeof(tmp))
+                                : static_cast<int>(::recv(fd_, tmp, sizeof(tmp), 0));
+        if (n <= 0) return false;
+        buf_.append(tmp, static_cast<size_t>(n));
+        return true;
+    }
+
+    int fd_ = -1;
+    SSL* ssl_ = nullptr;
+    std::string buf_;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    int tls_port = argc > 2 ? std::atoi(argv[2]) : 8443;
+    int plain_port = argc > 3 ? std::atoi(argv[3]) : 8080;
+    size_t connections = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 1000;
+    size_t heartbeats = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 20000;
+
+    // 基准只关心开销，不校验证书（服务端通常用自签名证书压测）
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+
+    std::string session_id;
+    {
+        Connection conn(ctx, host, tls_port);
+        std::string response;
+        if (!conn.ok() || !conn.post("/api/online/login", R"({"user_id":"tls_bench"})", response)) {
+            std::cerr << "login over TLS failed\n";
+            return 1;
+        }
+        session_id = json::parse(response, nullptr, false).value("/data/session_id"_json_pointer, std::string());
+    }
+    std::string heartbeat = json{{"session_id", session_id}}.dump();
+    std::string response;
+    size_t failures = 0;
+
+    runCase("full", connections, [&]() {
+        for (size_t i = 0; i < connections; ++i) {
+            Connection conn(ctx, host, tls_port);
+            if (!conn.post("/api/online/heartbeat", heartbeat, response)) ++failures;
+        }
+    });
+
+    size_t reused = 0;
+    SSL_SESSION* session = nullptr;
+    {
+        Connection conn(ctx, host, tls_port);
+        conn.post("/api/online/heartbeat", heartbeat, response);
+        session = conn.session();
+    }
+    runCase("resumed", connections, [&]() {
+        for (size_t i = 0; i < connections; ++i) {
+            Connection conn(ctx, host, tls_port, session);
+            if (!conn.post("/api/online/heartbeat", heartbeat, response)) ++failures;
+            if (conn.reused()) ++reused;
+            // TLS 1.3 每次握手下发新票据，沿用最新的
+            if (SSL_SESSION* next = conn.session()) {
+                SSL_SESSION_free(session);
+                session = next;
+            }
+        }
+    });
+    std::printf("           resumed %zu/%zu handshakes\n", reused, connections);
+    SSL_SESSION_free(session);
+
+    {
+        Connection conn(ctx, host, tls_port);
+        runCase("keepalive", heartbeats, [&]() {
+            for (size_t i = 0; i < heartbeats; ++i) {
+                if (!conn.post("/api/online/heartbeat", heartbeat, response)) ++failures;
+            }
+        });
+    }
+
+    if (plain_port > 0) {
+        Connection conn(nullptr, host, plain_port);
+        if (conn.ok()) {
+            runCase("plain", heartbeats, [&]() {
+                for (size_t i = 0; i < heartbeats; ++i) {
+                    if (!conn.post("/api/online/heartbeat", heartbeat, response)) ++failures;
+                }
+            });
+        }
+    }
+
+    SSL_CTX_free(ctx);
+    if (failures > 0) {
+        std::cerr << failures << " requests failed\n";
+        return 1;
+    }
+    return 0;
+}
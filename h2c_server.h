@@ -0,0 +1,478 @@
+// h2c_server.h - HTTP/2 明文（prior knowledge）监听
+//
+// 面向网关：一条连接上并发成千上万个心跳 / 校验流，头部经 HPACK 压缩。
+// 协议状态机由 nghttp2 负责，这里只做 I/O 和请求分发：
+//   - 每条连接一个线程，poll 等待 socket 和完成通知；一次读到的所有帧交给 nghttp2 解析，
+//     请求流结束时把请求交给共享的工作线程池，慢请求（如 /debug/profile）不会阻塞同一连接上的其它流
+//   - 工作线程处理完后把响应放进连接的完成队列并写 eventfd 唤醒连接线程，
+//     nghttp2 会话只在连接线程内访问
+//   - 每轮处理完输入和已完成的响应后把待发送的帧一次性写出，多个响应合并为一次系统调用
+// 请求转换成 httplib::Request / Response 后交给 Dispatcher，与 HTTP/1.1 监听共用处理函数。
+// 流式响应（set_chunked_content_provider）只在 HTTP/1.1 上提供，这里返回 501。
+#pragma once
+
+#include <httplib.h>
+#include <nghttp2/nghttp2.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class H2cServer {
+public:
+    // 处理请求；没有匹配的路由时返回 false，回复 404
+    using Dispatcher = std::function<bool(const httplib::Request&, httplib::Response&)>;
+
+    struct Options {
+        uint32_t max_concurrent_streams = 4096;   // 单连接并发流上限
+        uint32_t initial_window_size = 1 << 20;   // 流级接收窗口
+        size_t max_body_size = 1 << 20;           // 请求体上限，超过时回复 413
+        int idle_timeout_sec = 300;               // 连接空闲超时，超时后发送 GOAWAY 关闭
+        size_t worker_threads = 16;               // 执行处理函数的线程数，所有连接共用
+        httplib::Headers default_headers;         // 附加到每个响应，与 HTTP/1.1 监听一致
+    };
+
+    H2cServer(Dispatcher dispatcher, Options options)
+        : dispatcher_(std::move(dispatcher)), options_(std::move(options)) {}
+
+    ~H2cServer() { stop(); }
+
+    H2cServer(const H2cServer&) = delete;
+    H2cServer& operator=(const H2cServer&) = delete;
+
+    // 阻塞接受连接，直到 stop()；监听失败返回 false
+    bool listen(const std::string& host, int port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+            ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(fd, SOMAXCONN) != 0) {
+            ::close(fd);
+            return false;
+        }
+        listen_fd_ = fd;
+        startWorkers();
+
+        while (running_) {
+            sockaddr_in peer{};
+            socklen_t peer_len = sizeof(peer);
+            int conn = ::accept4(fd, reinterpret_cast<sockaddr*>(&peer), &peer_len, SOCK_CLOEXEC);
+            if (conn < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                break;
+            }
+            char ip[INET_ADDRSTRLEN] = {};
+            inet_ntop(AF_INET, &peer.sin_addr, ip, sizeof(ip));
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_) {
+                ::close(conn);
+                break;
+            }
+            connections_.insert(conn);
+            std::thread([this, conn, remote = std::string(ip), port = ntohs(peer.sin_port)]() {
+                Connection(*this, conn, remote, port).run();
+                std::lock_guard<std::mutex> lock(mtx_);
+                connections_.erase(conn);
+                ::close(conn);
+                closed_cv_.notify_all();
+            }).detach();
+        }
+
+        // 唤醒所有连接线程并等待它们退出
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            for (int conn : connections_) ::shutdown(conn, SHUT_RDWR);
+            closed_cv_.wait(lock, [this]() { return connections_.empty(); });
+        }
+        stopWorkers();
+        ::close(fd);
+        listen_fd_ = -1;
+        return true;
+    }
+
+    void stop() {
+        running_ = false;
+        int fd = listen_fd_.load();
+        if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+    }
+
+private:
+    // 连接的完成队列：工作线程放入响应后写 eventfd 唤醒连接线程。
+    // 由连接和在途任务共同持有，连接先退出时迟到的响应直接丢弃
+    struct Completions {
+        int event_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        std::mutex mtx;
+        std::vector<std::pair<int32_t, httplib::Response>> done;
+
+        ~Completions() {
+            if (event_fd >= 0) ::close(event_fd);
+        }
+
+        // 队列由空变非空时才写 eventfd，连接线程取走前的后续响应不再重复唤醒
+        void post(int32_t stream_id, httplib::Response res) {
+            bool wake = false;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                wake = done.empty();
+                done.emplace_back(stream_id, std::move(res));
+            }
+            uint64_t one = 1;
+            if (wake && ::write(event_fd, &one, sizeof(one)) < 0) {
+                // 计数器溢出之前连接线程早已被唤醒，忽略
+            }
+        }
+    };
+
+    void startWorkers() {
+        std::lock_guard<std::mutex> lock(jobs_mtx_);
+        workers_running_ = true;
+        for (size_t i = 0; i < std::max<size_t>(1, options_.worker_threads); ++i) {
+            workers_.emplace_back([this]() {
+                std::unique_lock<std::mutex> lock(jobs_mtx_);
+                while (true) {
+                    jobs_cv_.wait(lock, [this]() { return !workers_running_ || !jobs_.empty(); });
+                    if (!workers_running_) return;
+                    auto job = std::move(jobs_.front());
+                    jobs_.pop_front();
+                    lock.unlock();
+                    job();
+                    lock.lock();
+                }
+            });
+        }
+    }
+
+    // 所有连接已退出后调用，未执行的任务直接丢弃
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mtx_);
+            workers_running_ = false;
+            jobs_.clear();
+        }
+        jobs_cv_.notify_all();
+        for (auto& worker : workers_) worker.join();
+        workers_.clear();
+    }
+
+    // 一次读到的请求整批入队，只加一次锁
+    void submitJobs(std::vector<std::function<void()>>& jobs) {
+        if (jobs.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(jobs_mtx_);
+            for (auto& job : jobs) jobs_.push_back(std::move(job));
+        }
+        if (jobs.size() == 1) {
+            jobs_cv_.notify_one();
+        } else {
+            jobs_cv_.notify_all();
+        }
+        jobs.clear();
+    }
+
+    // 一条 HTTP/2 连接
+    class Connection {
+    public:
+        Connection(H2cServer& server, int fd, std::string remote_addr, int remote_port)
+            : server_(server), fd_(fd), remote_addr_(std::move(remote_addr)), remote_port_(remote_port) {}
+
+        ~Connection() {
+            if (session_ != nullptr) nghttp2_session_del(session_);
+        }
+
+        void run() {
+            if (completions_->event_fd < 0) return;
+            int one = 1;
+            setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            nghttp2_session_callbacks* callbacks = nullptr;
+            nghttp2_session_callbacks_new(&callbacks);
+            nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, onBeginHeaders);
+            nghttp2_session_callbacks_set_on_header_callback(callbacks, onHeader);
+            nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, onDataChunk);
+            nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, onFrameRecv);
+            nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, onStreamClose);
+            int rv = nghttp2_session_server_new(&session_, callbacks, this);
+            nghttp2_session_callbacks_del(callbacks);
+            if (rv != 0) return;
+
+            nghttp2_settings_entry settings[] = {
+                {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, server_.options_.max_concurrent_streams},
+                {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, server_.options_.initial_window_size},
+            };
+            nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings,
+                                    sizeof(settings) / sizeof(settings[0]));
+
+            char buf[65536];
+            pollfd fds[2] = {{fd_, POLLIN, 0}, {completions_->event_fd, POLLIN, 0}};
+            // 对端不再发送（如已收到 GOAWAY）时仍要等在途请求的响应发完
+            while (flush() && (nghttp2_session_want_read(session_) || in_flight_ > 0)) {
+                int ready = ::poll(fds, 2, server_.options_.idle_timeout_sec * 1000);
+                if (ready < 0 && errno == EINTR) continue;
+                if (ready < 0) break;
+                if (ready == 0) {
+                    if (in_flight_ > 0) continue;
+                    // 空闲超时：通知对端后关闭
+                    nghttp2_session_terminate_session(session_, NGHTTP2_NO_ERROR);
+                    flush();
+                    break;
+                }
+                if (fds[1].revents & POLLIN) drainCompletions();
+                if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) break;
+                    if (nghttp2_session_mem_recv(session_, reinterpret_cast<const uint8_t*>(buf),
+                                                 static_cast<size_t>(n)) < 0) {
+                        break;
+                    }
+                    server_.submitJobs(jobs_);
+                }
+            }
+        }
+
+    private:
+        struct Stream {
+            httplib::Request req;
+            std::string response_body;
+            size_t sent = 0;
+            bool body_too_large = false;
+        };
+
+        // 把 nghttp2 待发送的帧全部写出，写失败返回 false
+        bool flush() {
+            std::string out;
+            while (true) {
+                const uint8_t* data = nullptr;
+                ssize_t n = nghttp2_session_mem_send(session_, &data);
+                if (n < 0) return false;
+                if (n == 0) break;
+                out.append(reinterpret_cast<const char*>(data), static_cast<size_t>(n));
+            }
+            size_t sent = 0;
+            while (sent < out.size()) {
+                ssize_t n = ::send(fd_, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        // 请求流结束：解析查询参数后放入待提交列表，本轮输入解析完再整批交给工作线程；
+        // 请求体过大时直接回复 413
+        void handle(int32_t stream_id, Stream& stream) {
+            if (stream.body_too_large) {
+                httplib::Response res;
+                res.status = 413;
+                submitResponse(stream_id, stream, res);
+                return;
+            }
+
+            auto req = std::make_shared<httplib::Request>(std::move(stream.req));
+            req->version = "HTTP/2";
+            req->remote_addr = remote_addr_;
+            req->remote_port = remote_port_;
+            auto query = req->path.find('?');
+            if (query != std::string::npos) {
+                httplib::detail::parse_query_text(req->path.substr(query + 1), req->params);
+                req->path.resize(query);
+            }
+
+            ++in_flight_;
+            jobs_.push_back([&server = server_, completions = completions_, stream_id, req]() {
+                completions->post(stream_id, server.dispatch(*req));
+            });
+        }
+
+        // 取出工作线程已完成的响应并提交；流已被对端重置的直接丢弃
+        void drainCompletions() {
+            uint64_t count = 0;
+            if (::read(completions_->event_fd, &count, sizeof(count)) < 0) {
+                // EAGAIN：通知已被上一轮读走
+            }
+            std::vector<std::pair<int32_t, httplib::Response>> done;
+            {
+                std::lock_guard<std::mutex> lock(completions_->mtx);
+                done.swap(completions_->done);
+            }
+            for (auto& item : done) {
+                --in_flight_;
+                auto it = streams_.find(item.first);
+                if (it != streams_.end()) submitResponse(item.first, it->second, item.second);
+            }
+        }
+
+        void submitResponse(int32_t stream_id, Stream& stream, const httplib::Response& res) {
+            std::vector<std::pair<std::string, std::string>> fields;
+            fields.emplace_back(":status", std::to_string(res.status));
+            auto addHeaders = [&](const httplib::Headers& headers) {
+                for (const auto& header : headers) {
+                    std::string name = header.first;
+                    for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                    // HTTP/2 禁止连接级头部
+                    if (name == "connection" || name == "keep-alive" || name == "transfer-encoding" ||
+                        name == "content-length") {
+                        continue;
+                    }
+                    fields.emplace_back(std::move(name), header.second);
+                }
+            };
+            addHeaders(server_.options_.default_headers);
+            addHeaders(res.headers);
+            fields.emplace_back("content-length", std::to_string(res.body.size()));
+
+            std::vector<nghttp2_nv> nva;
+            nva.reserve(fields.size());
+            for (const auto& field : fields) {
+                nva.push_back({reinterpret_cast<uint8_t*>(const_cast<char*>(field.first.data())),
+                               reinterpret_cast<uint8_t*>(const_cast<char*>(field.second.data())),
+                               field.first.size(), field.second.size(), NGHTTP2_NV_FLAG_NONE});
+            }
+
+            stream.response_body = res.body;
+            nghttp2_data_provider provider{};
+            provider.source.ptr = &stream;
+            provider.read_callback = readBody;
+            nghttp2_submit_response(session_, stream_id, nva.data(), nva.size(),
+                                    res.body.empty() ? nullptr : &provider);
+        }
+
+        static ssize_t readBody(nghttp2_session*, int32_t, uint8_t* buf, size_t length,
+                                uint32_t* data_flags, nghttp2_data_source* source, void*) {
+            Stream& stream = *static_cast<Stream*>(source->ptr);
+            size_t n = std::min(length, stream.response_body.size() - stream.sent);
+            std::memcpy(buf, stream.response_body.data() + stream.sent, n);
+            stream.sent += n;
+            if (stream.sent == stream.response_body.size()) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+            return static_cast<ssize_t>(n);
+        }
+
+        static int onBeginHeaders(nghttp2_session*, const nghttp2_frame* frame, void* user_data) {
+            auto& self = *static_cast<Connection*>(user_data);
+            if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+                self.streams_[frame->hd.stream_id];
+            }
+            return 0;
+        }
+
+        static int onHeader(nghttp2_session*, const nghttp2_frame* frame, const uint8_t* name,
+                            size_t namelen, const uint8_t* value, size_t valuelen, uint8_t,
+                            void* user_data) {
+            auto& self = *static_cast<Connection*>(user_data);
+            auto it = self.streams_.find(frame->hd.stream_id);
+            if (it == self.streams_.end()) return 0;
+            httplib::Request& req = it->second.req;
+            std::string key(reinterpret_cast<const char*>(name), namelen);
+            std::string val(reinterpret_cast<const char*>(value), valuelen);
+            if (key == ":method") {
+                req.method = std::move(val);
+            } else if (key == ":path") {
+                req.path = std::move(val);
+            } else if (key == ":authority") {
+                req.headers.emplace("Host", std::move(val));
+            } else if (key[0] != ':') {
+                req.headers.emplace(std::move(key), std::move(val));
+            }
+            return 0;
+        }
+
+        static int onDataChunk(nghttp2_session*, uint8_t, int32_t stream_id, const uint8_t* data,
+                               size_t len, void* user_data) {
+            auto& self = *static_cast<Connection*>(user_data);
+            auto it = self.streams_.find(stream_id);
+            if (it == self.streams_.end()) return 0;
+            Stream& stream = it->second;
+            if (stream.req.body.size() + len > self.server_.options_.max_body_size) {
+                stream.body_too_large = true;
+                return 0;
+            }
+            stream.req.body.append(reinterpret_cast<const char*>(data), len);
+            return 0;
+        }
+
+        static int onFrameRecv(nghttp2_session*, const nghttp2_frame* frame, void* user_data) {
+            auto& self = *static_cast<Connection*>(user_data);
+            if ((frame->hd.type == NGHTTP2_HEADERS || frame->hd.type == NGHTTP2_DATA) &&
+                (frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+                auto it = self.streams_.find(frame->hd.stream_id);
+                if (it != self.streams_.end()) self.handle(frame->hd.stream_id, it->second);
+            }
+            return 0;
+        }
+
+        static int onStreamClose(nghttp2_session*, int32_t stream_id, uint32_t, void* user_data) {
+            static_cast<Connection*>(user_data)->streams_.erase(stream_id);
+            return 0;
+        }
+
+        H2cServer& server_;
+        int fd_;
+        std::string remote_addr_;
+        int remote_port_;
+        nghttp2_session* session_ = nullptr;
+        std::unordered_map<int32_t, Stream> streams_;   // 节点地址稳定，可作为 data provider 的来源
+        std::shared_ptr<Completions> completions_ = std::make_shared<Completions>();
+        std::vector<std::function<void()>> jobs_;       // 本轮解析出的请求，解析完整批提交
+        size_t in_flight_ = 0;                          // 已交给工作线程、尚未取回响应的请求数
+    };
+
+    // 在工作线程内执行处理函数
+    httplib::Response dispatch(const httplib::Request& req) {
+        httplib::Response res;
+        try {
+            if (!dispatcher_(req, res)) res.status = 404;
+        } catch (const std::exception& e) {
+            res.status = 500;
+            res.body = e.what();
+        }
+        if (res.content_provider_) {
+            httplib::Response unsupported;
+            unsupported.status = 501;
+            unsupported.set_content("streaming responses require HTTP/1.1", "text/plain");
+            return unsupported;
+        }
+        if (res.status == -1) res.status = 200;
+        return res;
+    }
+
+    Dispatcher dispatcher_;
+    Options options_;
+    std::atomic<bool> running_{true};
+    std::atomic<int> listen_fd_{-1};
+    std::mutex mtx_;
+    std::condition_variable closed_cv_;
+    std::unordered_set<int> connections_;   // 活跃连接，由各自的线程在退出时移除
+
+    std::mutex jobs_mtx_;
+    std::condition_variable jobs_cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> workers_;
+    bool workers_running_ = false;
+};
@@ -0,0 +1,225 @@
+// last_seen_store.h - 离线用户最后在线时间表
+//
+// 用户 ID 哈希为 64 位句柄，映射到 32 位 Unix 时间戳（秒）。句柄会写进持久化文件，
+// 因此用本文件自己定义的 FNV-1a，不用实现相关的 std::hash；文件头记录哈希算法编号，不一致时整表重建。
+// 结构为 8 路组相联表：句柄决定所在组，组内最多 8 项，查找和更新都是 O(1)。
+// 组满时按 CLOCK 思路淘汰：优先淘汰最近没被查询过（引用位为 0）的项中最早离线的，
+// 全部被引用过则清空引用位后淘汰最早离线的。内存上限固定为 capacity * 16 字节。
+// 指定文件路径时表映射到文件（MAP_SHARED），重启后数据仍然保留。
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class LastSeenStore {
+public:
+    // capacity 向上取整为 kWays 的倍数；path 为空时使用匿名内存
+    explicit LastSeenStore(size_t capacity, const std::string& path = "") {
+        num_sets_ = std::max<size_t>(1, (capacity + kWays - 1) / kWays);
+        size_t bytes = sizeof(FileHeader) + num_sets_ * kWays * sizeof(Entry);
+
+        if (!path.empty() && mapFile(path, bytes)) {
+            persistent_ = true;
+        } else {
+            void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) {
+                throw std::runtime_error("last seen store: mmap failed");
+            }
+            base_ = mem;
+            initHeader();
+        }
+        mapped_bytes_ = bytes;
+        entries_ = reinterpret_cast<Entry*>(static_cast<char*>(base_) + sizeof(FileHeader));
+
+        for (size_t i = 0; i < num_sets_ * kWays; ++i) {
+            if (entries_[i].key != 0) ++size_;
+        }
+    }
+
+    ~LastSeenStore() {
+        if (base_ != nullptr) {
+            if (persistent_) msync(base_, mapped_bytes_, MS_ASYNC);
+            munmap(base_, mapped_bytes_);
+        }
+    }
+
+    LastSeenStore(const LastSeenStore&) = delete;
+    LastSeenStore& operator=(const LastSeenStore&) = delete;
+
+    // 记录用户最后在线时间（最后一个会话结束时调用）
+    void update(const std::string& user_id, uint32_t timestamp) {
+        uint64_t key = handleOf(user_id);
+        std::lock_guard<std::mutex> lock(mtx_);
+        Entry* set = setOf(key);
+
+        Entry* empty = nullptr;
+        for (size_t i = 0; i < kWays; ++i) {
+            if (set[i].key == key) {
+                set[i].timestamp = timestamp;
+                return;
+            }
+            if (set[i].key == 0 && empty == nullptr) {
+                empty = &set[i];
+            }
+        }
+
+        Entry* victim = empty != nullptr ? empty : evict(set);
+        if (victim->key == 0) ++size_;
+        victim->key = key;
+        victim->timestamp = timestamp;
+        victim->referenced = 0;
+    }
+
+    std::optional<uint32_t> lookup(const std::string& user_id) {
+        uint64_t key = handleOf(user_id);
+        std::lock_guard<std::mutex> lock(mtx_);
+        return find(key);
+    }
+
+    // 批量查询：先在锁外算好所有句柄，再一次加锁完成查找
+    std::vector<std::optional<uint32_t>> lookupBatch(const std::vector<std::string>& user_ids) {
+        std::vector<uint64_t> keys;
+        keys.reserve(user_ids.size());
+        for (const auto& id : user_ids) keys.push_back(handleOf(id));
+
+        std::vector<std::optional<uint32_t>> results;
+        results.reserve(keys.size());
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (uint64_t key : keys) results.push_back(find(key));
+        return results;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return size_;
+    }
+
+    size_t capacity() const { return num_sets_ * kWays; }
+
+private:
+    static constexpr size_t kWays = 8;
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kHashId = 0x31564e46;   // "FNV1"：FNV-1a 64 + splitmix64 混合
+
+    struct Entry {
+        uint64_t key;          // 0 表示空槽
+        uint32_t timestamp;
+        uint32_t referenced;   // CLOCK 引用位，查询命中时置 1
+    };
+    static_assert(sizeof(Entry) == 16, "entry must stay compact");
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_size;
+        uint64_t num_sets;
+        uint32_t hash_id;      // 句柄算法编号，旧文件为 0
+        char reserved[36];
+    };
+    static_assert(sizeof(FileHeader) == 64, "header keeps entries cache-line aligned");
+
+    static uint64_t handleOf(const std::string& user_id) {
+        uint64_t x = 0xcbf29ce484222325ULL;
+        for (unsigned char c : user_id) {
+            x ^= c;
+            x *= 0x100000001b3ULL;
+        }
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x | 1;  // 0 保留给空槽
+    }
+
+    Entry* setOf(uint64_t key) {
+        return entries_ + (key >> 1) % num_sets_ * kWays;
+    }
+
+    std::optional<uint32_t> find(uint64_t key) {
+        Entry* set = setOf(key);
+        for (size_t i = 0; i < kWays; ++i) {
+            if (set[i].key == key) {
+                set[i].referenced = 1;
+                return set[i].timestamp;
+            }
+        }
+        return std::nullopt;
+    }
+
+    static Entry* evict(Entry* set) {
+        Entry* victim = nullptr;
+        for (size_t i = 0; i < kWays; ++i) {
+            if (set[i].referenced == 0 &&
+                (victim == nullptr || set[i].timestamp < victim->timestamp)) {
+                victim = &set[i];
+            }
+        }
+        if (victim != nullptr) return victim;
+
+        // 所有项都被查询过：给它们一次机会，清空引用位后淘汰最早离线的
+        victim = &set[0];
+        for (size_t i = 0; i < kWays; ++i) {
+            set[i].referenced = 0;
+            if (set[i].timestamp < victim->timestamp) victim = &set[i];
+        }
+        return victim;
+    }
+
+    void initHeader() {
+        auto* header = static_cast<FileHeader*>(base_);
+        std::memset(header, 0, sizeof(FileHeader));
+        std::memcpy(header->magic, "LASTSEEN", 8);
+        header->version = kVersion;
+        header->entry_size = sizeof(Entry);
+        header->num_sets = num_sets_;
+        header->hash_id = kHashId;
+    }
+
+    // 映射持久化文件；文件格式、容量或哈希算法不匹配时清空重建
+    bool mapFile(const std::string& path, size_t bytes) {
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+
+        struct stat st{};
+        bool reuse = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == bytes;
+        if (!reuse && (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(bytes)) != 0)) {
+            close(fd);
+            return false;
+        }
+
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) return false;
+        base_ = mem;
+
+        auto* header = static_cast<FileHeader*>(base_);
+        if (!reuse || std::memcmp(header->magic, "LASTSEEN", 8) != 0 ||
+            header->version != kVersion || header->entry_size != sizeof(Entry) ||
+            header->num_sets != num_sets_ || header->hash_id != kHashId) {
+            std::memset(base_, 0, bytes);
+            initHeader();
+        }
+        return true;
+    }
+
+    mutable std::mutex mtx_;
+    void* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    Entry* entries_ = nullptr;
+    size_t num_sets_ = 0;
+    size_t size_ = 0;
+    bool persistent_ = false;
+};
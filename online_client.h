@@ -0,0 +1,773 @@
+// online_client.h - 在线人数统计服务 C++ 客户端 SDK
+//
+// 面向网关的 header-only 客户端：
+//   - keep-alive 连接池，避免每次请求重建 TCP 连接
+//   - heartbeatAsync() 自动把多个会话的心跳合并为一次批量请求
+//   - pipeline() 在同一连接上流水线发送多个请求
+//   - track() 托管会话，按服务端下发的 heartbeat_interval 自动续期
+//   - 网络错误与 5xx 按指数退避 + 随机抖动重试；请求已发出后的失败只重试幂等请求
+//   - exportSessions() 流式下载会话表的 Arrow IPC 导出
+//
+// 依赖 nlohmann/json，仅使用 POSIX socket。
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace online {
+
+using json = nlohmann::json;
+
+struct ClientOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    size_t pool_size = 8;          // 连接池保留的最大空闲连接数
+    int connect_timeout_ms = 1000;
+    int io_timeout_ms = 3000;
+    int max_retries = 3;           // 失败后的最大重试次数
+    int retry_base_ms = 50;        // 退避基数，第 n 次重试等待 [0, base * 2^n] 内的随机时间
+    int retry_max_ms = 2000;       // 单次退避等待上限
+    size_t batch_max = 256;        // 单个批量心跳最多包含的会话数
+    int flush_interval_ms = 20;    // 合并心跳的最长攒批时间
+    size_t pipeline_depth = 32;    // 流水线每轮最多在途请求数，防止双方缓冲区写满互相阻塞
+    std::string admin_token;       // 服务端的 ONLINE_ADMIN_TOKEN，只随 /api/admin/ 请求发送
+};
+
+struct HttpCall {
+    std::string method;
+    std::string path;
+    std::string body;
+    bool idempotent = false;   // 重复执行无副作用，请求发出后失败也可以重发
+};
+
+struct HttpResponse {
+    int status = 0;
+    std::string body;
+    bool keep_alive = true;
+    std::string content_type;
+};
+
+// 流式接收响应体，返回 false 中止读取
+using BodySink = std::function<bool(const char* data, size_t size)>;
+
+class ClientError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// 单条 HTTP/1.1 连接，支持 Content-Length 与 chunked 响应
+class HttpConnection {
+public:
+    explicit HttpConnection(const ClientOptions& opts) : opts_(opts) {}
+    ~HttpConnection() { close(); }
+
+    HttpConnection(const HttpConnection&) = delete;
+    HttpConnection& operator=(const HttpConnection&) = delete;
+
+    bool connect() {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        std::string port = std::to_string(opts_.port);
+        if (getaddrinfo(opts_.host.c_str(), port.c_str(), &hints, &result) != 0) {
+            return false;
+        }
+
+        for (addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+            int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (connectWithTimeout(fd, ai->ai_addr, ai->ai_addrlen)) {
+                fd_ = fd;
+                break;
+            }
+            ::close(fd);
+        }
+        freeaddrinfo(result);
+        if (fd_ < 0) return false;
+
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval tv{};
+        tv.tv_sec = opts_.io_timeout_ms / 1000;
+        tv.tv_usec = (opts_.io_timeout_ms % 1000) * 1000;
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        return true;
+    }
+
+    // 空闲连接是否已失效：闲置期间变为可读，说明对端已关闭或发来了多余数据
+    bool stale() const {
+        pollfd pfd{fd_, POLLIN, 0};
+        return ::poll(&pfd, 1, 0) != 0;
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        buf_.clear();
+        pos_ = 0;
+    }
+
+    // 失败时 sent 为已写入内核的字节数，据此判断哪些请求可能已到达服务端
+    bool send(const std::string& data, size_t* sent_out = nullptr) {
+        size_t sent = 0;
+        bool ok = true;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        if (sent_out != nullptr) *sent_out = sent;
+        return ok;
+    }
+
+    // 读取一个响应；给定 sink 时响应体边读边交给 sink，不在 resp.body 中累积
+    bool readResponse(HttpResponse& resp, const BodySink& sink = nullptr) {
+        std::string line;
+        if (!readLine(line)) return false;
+        // 状态行：HTTP/1.1 200 OK
+        if (line.size() < 12 || line.compare(0, 5, "HTTP/") != 0) return false;
+        resp.status = std::atoi(line.c_str() + 9);
+        resp.keep_alive = line.compare(0, 8, "HTTP/1.0") != 0;
+        resp.body.clear();
+        resp.content_type.clear();
+
+        long content_length = -1;
+        bool chunked = false;
+        while (true) {
+            if (!readLine(line)) return false;
+            if (line.empty()) break;
+            auto colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = lower(line.substr(0, colon));
+            std::string value = trim(line.substr(colon + 1));
+            if (name == "content-length") {
+                content_length = std::atol(value.c_str());
+            } else if (name == "content-type") {
+                resp.content_type = value;
+            } else if (name == "transfer-encoding") {
+                chunked = lower(value).find("chunked") != std::string::npos;
+            } else if (name == "connection") {
+                std::string v = lower(value);
+                if (v == "close") resp.keep_alive = false;
+                if (v == "keep-alive") resp.keep_alive = true;
+            }
+        }
+
+        if (chunked) {
+            while (true) {
+                if (!readLine(line)) return false;
+                size_t size = std::strtoul(line.c_str(), nullptr, 16);
+                if (size == 0) {
+                    // 跳过 trailer 直到空行
+                    do {
+                        if (!readLine(line)) return false;
+                    } while (!line.empty());
+                    break;
+                }
+                if (!readExact(size, resp.body) || !deliver(resp, sink)) return false;
+                if (!readLine(line)) return false;
+            }
+        } else if (content_length >= 0) {
+            // 有 sink 时分段读取，避免整个响应体驻留内存
+            size_t remaining = static_cast<size_t>(content_length);
+            while (remaining > 0) {
+                size_t n = sink ? std::min<size_t>(remaining, 65536) : remaining;
+                if (!readExact(n, resp.body) || !deliver(resp, sink)) return false;
+                remaining -= n;
+            }
+        } else {
+            // 无长度信息，读到连接关闭为止
+            do {
+                resp.body.append(buf_, pos_, std::string::npos);
+                pos_ = buf_.size();
+                if (!deliver(resp, sink)) return false;
+            } while (fill());
+            resp.keep_alive = false;
+        }
+        return true;
+    }
+
+    // 把请求序列化追加到 out，便于流水线一次写出多个请求
+    static void appendRequest(std::string& out, const ClientOptions& opts, const HttpCall& call) {
+        out += call.method;
+        out += ' ';
+        out += call.path;
+        out += " HTTP/1.1\r\nHost: ";
+        out += opts.host;
+        out += ':';
+        out += std::to_string(opts.port);
+        out += "\r\nConnection: keep-alive\r\n";
+        if (!opts.admin_token.empty() && call.path.compare(0, 11, "/api/admin/") == 0) {
+            out += "Authorization: Bearer ";
+            out += opts.admin_token;
+            out += "\r\n";
+        }
+        if (!call.body.empty() || call.method == "POST") {
+            out += "Content-Type: application/json\r\nContent-Length: ";
+            out += std::to_string(call.body.size());
+            out += "\r\n";
+        }
+        out += "\r\n";
+        out += call.body;
+    }
+
+private:
+    static bool deliver(HttpResponse& resp, const BodySink& sink) {
+        if (!sink || resp.body.empty()) return true;
+        bool ok = sink(resp.body.data(), resp.body.size());
+        resp.body.clear();
+        return ok;
+    }
+
+    bool connectWithTimeout(int fd, const sockaddr* addr, socklen_t len) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        int rc = ::connect(fd, addr, len);
+        if (rc < 0 && errno != EINPROGRESS) return false;
+        if (rc < 0) {
+            pollfd pfd{fd, POLLOUT, 0};
+            if (poll(&pfd, 1, opts_.connect_timeout_ms) <= 0) return false;
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err != 0) return false;
+        }
+        fcntl(fd, F_SETFL, flags);
+        return true;
+    }
+
+    bool fill() {
+        if (pos_ > 0 && pos_ == buf_.size()) {
+            buf_.clear();
+            pos_ = 0;
+        } else if (pos_ > 65536) {
+            buf_.erase(0, pos_);
+            pos_ = 0;
+        }
+        char tmp[16384];
+        while (true) {
+            ssize_t n = ::recv(fd_, tmp, sizeof(tmp), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buf_.append(tmp, static_cast<size_t>(n));
+            return true;
+        }
+    }
+
+    bool readLine(std::string& line) {
+        while (true) {
+            auto end = buf_.find("\r\n", pos_);
+            if (end != std::string::npos) {
+                line.assign(buf_, pos_, end - pos_);
+                pos_ = end + 2;
+                return true;
+            }
+            if (!fill()) return false;
+        }
+    }
+
+    bool readExact(size_t n, std::string& out) {
+        while (buf_.size() - pos_ < n) {
+            if (!fill()) return false;
+        }
+        out.append(buf_, pos_, n);
+        pos_ += n;
+        return true;
+    }
+
+    static std::string lower(std::string s) {
+        for (auto& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    static std::string trim(const std::string& s) {
+        auto b = s.find_first_not_of(" \t");
+        if (b == std::string::npos) return "";
+        auto e = s.find_last_not_of(" \t");
+        return s.substr(b, e - b + 1);
+    }
+
+    const ClientOptions& opts_;
+    int fd_ = -1;
+    std::string buf_;
+    size_t pos_ = 0;
+};
+
+// keep-alive 连接池：空闲连接复用，超出 pool_size 的连接用完即关
+class ConnectionPool {
+public:
+    explicit ConnectionPool(const ClientOptions& opts) : opts_(opts) {}
+
+    // 取出一个可用连接；reused 表示是否复用的空闲连接（可能已被服务端关闭）
+    std::unique_ptr<HttpConnection> acquire(bool& reused) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!idle_.empty()) {
+                auto conn = std::move(idle_.back());
+                idle_.pop_back();
+                reused = true;
+                return conn;
+            }
+        }
+        reused = false;
+        auto conn = std::make_unique<HttpConnection>(opts_);
+        if (!conn->connect()) return nullptr;
+        return conn;
+    }
+
+    void release(std::unique_ptr<HttpConnection> conn) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (idle_.size() < opts_.pool_size) {
+            idle_.push_back(std::move(conn));
+        }
+    }
+
+private:
+    const ClientOptions& opts_;
+    std::mutex mtx_;
+    std::vector<std::unique_ptr<HttpConnection>> idle_;
+};
+
+class OnlineClient {
+public:
+    struct LoginResult {
+        std::string session_id;
+        int online_count = 0;
+    };
+
+    explicit OnlineClient(ClientOptions opts = {})
+        : opts_(std::move(opts)), pool_(opts_) {
+        worker_ = std::thread([this]() { workerLoop(); });
+    }
+
+    ~OnlineClient() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    OnlineClient(const OnlineClient&) = delete;
+    OnlineClient& operator=(const OnlineClient&) = delete;
+
+    // 用户登录，可选直接进入房间，失败时抛出 ClientError
+    LoginResult login(const std::string& user_id, const std::string& room_id = "") {
+        json body = {{"user_id", user_id}};
+        if (!room_id.empty()) body["room_id"] = room_id;
+        auto data = callApi({"POST", "/api/online/login", body.dump()});
+        LoginResult result;
+        result.session_id = data.value("session_id", "");
+        result.online_count = data.value("online_count", 0);
+        return result;
+    }
+
+    // 同步单次心跳，会话无效时返回 false
+    bool heartbeat(const std::string& session_id) {
+        auto resp = request({"POST", "/api/online/heartbeat", json{{"session_id", session_id}}.dump(), true});
+        auto j = json::parse(resp.body, nullptr, false);
+        if (j.is_discarded()) throw ClientError("malformed response");
+        observe(j);
+        return j.value("code", -1) == 0;
+    }
+
+    // 异步心跳：与同一时间窗口内的其它心跳合并为一次批量请求
+    // 网络失败时 future 抛出 ClientError，会话无效时结果为 false
+    std::future<bool> heartbeatAsync(const std::string& session_id) {
+        std::promise<bool> promise;
+        auto future = promise.get_future();
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (pending_.empty()) {
+                pending_since_ = std::chrono::steady_clock::now();
+                wake = true;
+            }
+            pending_.push_back({session_id, std::move(promise)});
+            wake = wake || pending_.size() >= opts_.batch_max;
+        }
+        if (wake) cv_.notify_one();
+        return future;
+    }
+
+    // 批量心跳，超过 batch_max 时自动拆分，结果与输入一一对应
+    std::vector<bool> heartbeatBatch(const std::vector<std::string>& session_ids) {
+        std::vector<bool> results;
+        results.reserve(session_ids.size());
+        for (size_t begin = 0; begin < session_ids.size(); begin += opts_.batch_max) {
+            size_t end = std::min(session_ids.size(), begin + opts_.batch_max);
+            std::vector<std::string> chunk(session_ids.begin() + begin, session_ids.begin() + end);
+            auto data = callApi({"POST", "/api/online/heartbeat/batch",
+                                 json{{"session_ids", chunk}}.dump(), true});
+            auto chunk_results = data.value("results", std::vector<bool>{});
+            chunk_results.resize(chunk.size(), false);
+            results.insert(results.end(), chunk_results.begin(), chunk_results.end());
+        }
+        return results;
+    }
+
+    void logout(const std::string& session_id) {
+        untrack(session_id);
+        callApi({"POST", "/api/online/logout", json{{"session_id", session_id}}.dump(), true});
+    }
+
+    // 切换房间，返回新房间的在线人数；room_id 为空表示离开房间
+    int moveRoom(const std::string& session_id, const std::string& room_id) {
+        auto data = callApi({"POST", "/api/online/room/move",
+                             json{{"session_id", session_id}, {"room_id", room_id}}.dump(), true});
+        return data.value("room_count", 0);
+    }
+
+    bool validate(const std::string& session_id) {
+        auto data = callApi({"POST", "/api/online/validate", json{{"session_id", session_id}}.dump(), true});
+        return data.value("valid", false);
+    }
+
+    int onlineCount() {
+        auto data = callApi({"GET", "/api/online/count", "", true});
+        return data.value("online_count", 0);
+    }
+
+    // 流式下载会话表导出（Arrow IPC 流），数据按到达顺序交给 sink，返回总字节数
+    // compression 为 "zstd" 或 "none"；batch_rows 为 0 时使用服务端默认值
+    // 中途失败无法续传，因此不重试，直接抛出 ClientError
+    size_t exportSessions(const BodySink& sink, const std::string& compression = "zstd",
+                          size_t batch_rows = 0) {
+        std::string path = "/api/admin/export?compression=" + compression;
+        if (batch_rows > 0) path += "&batch_rows=" + std::to_string(batch_rows);
+        std::string raw;
+        HttpConnection::appendRequest(raw, opts_, {"GET", path, ""});
+
+        // 导出可能持续较久，使用独立连接，不占用也不归还连接池
+        HttpConnection conn(opts_);
+        if (!conn.connect() || !conn.send(raw)) throw ClientError("cannot connect for export");
+
+        HttpResponse resp;
+        size_t total = 0;
+        std::string error;
+        bool ok = conn.readResponse(resp, [&](const char* data, size_t size) {
+            // 参数错误时服务端返回 JSON，收集起来用于报错
+            if (resp.status != 200 || resp.content_type.find("json") != std::string::npos) {
+                error.append(data, size);
+                return true;
+            }
+            total += size;
+            return sink(data, size);
+        });
+        if (!error.empty() || resp.status != 200) {
+            auto j = json::parse(error, nullptr, false);
+            std::string message = j.is_object() ? j.value("message", "unknown error")
+                                                : "HTTP " + std::to_string(resp.status);
+            throw ClientError("export failed: " + message);
+        }
+        if (!ok) throw ClientError("export interrupted after " + std::to_string(total) + " bytes");
+        return total;
+    }
+
+    // 在同一连接上流水线发送多个请求，响应按请求顺序返回
+    // 连接中断时未收到响应的请求会在新连接上重发，因此只适合幂等请求（心跳、校验、查询）；
+    // 已发出（哪怕只发出一部分）但未收到响应的请求中有非幂等的，不重发，直接抛出 ClientError
+    std::vector<HttpResponse> pipeline(const std::vector<HttpCall>& calls) {
+        std::vector<HttpResponse> responses;
+        responses.reserve(calls.size());
+        int attempt = 0;
+        bool all_idempotent = std::all_of(calls.begin(), calls.end(),
+                                          [](const HttpCall& call) { return call.idempotent; });
+
+        while (responses.size() < calls.size()) {
+            bool reused = false;
+            auto conn = pool_.acquire(reused);
+            if (conn && reused && !all_idempotent && conn->stale()) continue;
+            bool failed = !conn;
+            size_t before = responses.size();
+
+            while (!failed && responses.size() < calls.size()) {
+                size_t begin = responses.size();
+                size_t end = std::min(calls.size(), begin + opts_.pipeline_depth);
+                std::string raw;
+                std::vector<size_t> offsets;   // 每个请求在 raw 中的起始位置
+                offsets.reserve(end - begin);
+                for (size_t i = begin; i < end; ++i) {
+                    offsets.push_back(raw.size());
+                    HttpConnection::appendRequest(raw, opts_, calls[i]);
+                }
+                size_t sent = 0;
+                if (!conn->send(raw, &sent)) {
+                    for (size_t i = begin; i < end && offsets[i - begin] < sent; ++i) {
+                        if (!calls[i].idempotent) {
+                            throw ClientError("pipeline " + calls[i].path + " partly sent, not retried");
+                        }
+                    }
+                    failed = true;
+                    break;
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    HttpResponse resp;
+                    if (!conn->readResponse(resp)) {
+                        for (size_t j = i; j < end; ++j) {
+                            if (!calls[j].idempotent) {
+                                throw ClientError("pipeline " + calls[j].path + " failed after send, not retried");
+                            }
+                        }
+                        failed = true;
+                        break;
+                    }
+                    bool keep_alive = resp.keep_alive;
+                    responses.push_back(std::move(resp));
+                    if (!keep_alive) {
+                        // 服务端要求关闭连接，剩余请求换新连接发送
+                        failed = responses.size() < calls.size();
+                        conn.reset();
+                        break;
+                    }
+                }
+            }
+
+            if (!failed) {
+                if (conn) pool_.release(std::move(conn));
+                break;
+            }
+            // 复用的空闲连接在没有任何进展时失败，多半是服务端已关闭，直接换新连接
+            if (reused && responses.size() == before) continue;
+            if (responses.size() == before && attempt++ >= opts_.max_retries) {
+                throw ClientError("pipeline failed after retries");
+            }
+            if (responses.size() == before) backoff(attempt);
+        }
+        return responses;
+    }
+
+    // 托管会话：后台按服务端下发的心跳间隔批量续期
+    void track(const std::string& session_id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tracked_.insert(session_id);
+    }
+
+    void untrack(const std::string& session_id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tracked_.erase(session_id);
+    }
+
+    // 托管会话续期失败（服务端判定无效）时回调，回调在后台线程中执行
+    void onSessionLost(std::function<void(const std::string&)> callback) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        on_session_lost_ = std::move(callback);
+    }
+
+    // 服务端最近一次下发的心跳间隔（秒）
+    int heartbeatInterval() const {
+        return heartbeat_interval_.load(std::memory_order_relaxed);
+    }
+
+    // 带重试的单个请求；4xx 及业务错误直接返回
+    // 请求还没发出（连接、发送失败）时总是重试；已发出后读响应失败或收到 5xx，
+    // 服务端可能已经执行过，只有 call.idempotent 的请求才重发，
+    // 非幂等请求（登录）读失败抛出 ClientError，5xx 原样返回，避免产生重复会话
+    HttpResponse request(const HttpCall& call) {
+        std::string raw;
+        HttpConnection::appendRequest(raw, opts_, call);
+
+        for (int attempt = 0;; ++attempt) {
+            bool reused = false;
+            auto conn = pool_.acquire(reused);
+            if (conn && reused && !call.idempotent && conn->stale()) {
+                // 非幂等请求发出后就不能重发，先丢掉已被服务端关闭的空闲连接
+                --attempt;
+                continue;
+            }
+            if (conn) {
+                if (conn->send(raw)) {
+                    HttpResponse resp;
+                    bool ok = conn->readResponse(resp);
+                    if (ok && resp.keep_alive) pool_.release(std::move(conn));
+                    if (ok && (resp.status < 500 || !call.idempotent)) return resp;
+                    if (!ok && !call.idempotent) {
+                        throw ClientError("request " + call.path + " failed after send, not retried");
+                    }
+                    if (!ok && reused) {
+                        // 空闲连接已被服务端关闭，立即换新连接重试，不计入重试次数
+                        --attempt;
+                        continue;
+                    }
+                } else if (reused) {
+                    --attempt;
+                    continue;
+                }
+            }
+            if (attempt >= opts_.max_retries) {
+                throw ClientError("request " + call.path + " failed after retries");
+            }
+            backoff(attempt);
+        }
+    }
+
+private:
+    struct PendingHeartbeat {
+        std::string session_id;
+        std::promise<bool> promise;
+    };
+
+    // 发送请求并解析统一响应格式，code != 0 时抛出 ClientError，返回 data 字段
+    json callApi(const HttpCall& call) {
+        auto resp = request(call);
+        auto j = json::parse(resp.body, nullptr, false);
+        if (j.is_discarded()) throw ClientError("malformed response from " + call.path);
+        if (j.value("code", -1) != 0) {
+            throw ClientError(call.path + ": " + j.value("message", "unknown error"));
+        }
+        observe(j);
+        return j.contains("data") ? j["data"] : json::object();
+    }
+
+    // 记录服务端下发的心跳间隔
+    void observe(const json& j) {
+        auto it = j.find("data");
+        if (it == j.end() || !it->is_object()) return;
+        auto interval = it->find("heartbeat_interval");
+        if (interval != it->end() && interval->is_number_integer() && interval->get<int>() > 0) {
+            heartbeat_interval_.store(interval->get<int>(), std::memory_order_relaxed);
+        }
+    }
+
+    // 指数退避 + full jitter，避免大量网关同时重试
+    void backoff(int attempt) {
+        thread_local std::mt19937 gen(std::random_device{}());
+        long cap = std::min<long>(opts_.retry_max_ms,
+                                  static_cast<long>(opts_.retry_base_ms) << std::min(attempt, 20));
+        std::uniform_int_distribution<long> dis(0, std::max<long>(cap, 1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(dis(gen)));
+    }
+
+    void flushPending(std::vector<PendingHeartbeat>& batch) {
+        std::vector<std::string> ids;
+        ids.reserve(batch.size());
+        for (auto& p : batch) ids.push_back(p.session_id);
+        try {
+            auto results = heartbeatBatch(ids);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].promise.set_value(results[i]);
+            }
+        } catch (...) {
+            for (auto& p : batch) p.promise.set_exception(std::current_exception());
+        }
+    }
+
+    void renewTracked(const std::vector<std::string>& ids) {
+        std::vector<bool> results;
+        try {
+            results = heartbeatBatch(ids);
+        } catch (const ClientError&) {
+            return;  // 网络问题不视为会话失效，下个周期重试
+        }
+        std::vector<std::string> lost;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (!results[i]) lost.push_back(ids[i]);
+        }
+        if (lost.empty()) return;
+
+        std::function<void(const std::string&)> callback;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto& id : lost) tracked_.erase(id);
+            callback = on_session_lost_;
+        }
+        if (callback) {
+            for (auto& id : lost) callback(id);
+        }
+    }
+
+    // 后台线程：按攒批窗口发送合并心跳，按心跳间隔续期托管会话
+    void workerLoop() {
+        using clock = std::chrono::steady_clock;
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto next_tick = clock::now() + std::chrono::seconds(heartbeatInterval());
+
+        while (running_) {
+            auto deadline = next_tick;
+            if (!pending_.empty()) {
+                deadline = std::min(deadline, pending_since_ + std::chrono::milliseconds(opts_.flush_interval_ms));
+            }
+            cv_.wait_until(lock, deadline, [&]() {
+                return !running_ || pending_.size() >= opts_.batch_max;
+            });
+
+            auto now = clock::now();
+            if (!pending_.empty() &&
+                (!running_ || pending_.size() >= opts_.batch_max ||
+                 now >= pending_since_ + std::chrono::milliseconds(opts_.flush_interval_ms))) {
+                std::vector<PendingHeartbeat> batch;
+                batch.swap(pending_);
+                lock.unlock();
+                flushPending(batch);
+                lock.lock();
+            }
+
+            if (running_ && now >= next_tick) {
+                std::vector<std::string> ids(tracked_.begin(), tracked_.end());
+                lock.unlock();
+                if (!ids.empty()) renewTracked(ids);
+                lock.lock();
+                next_tick = clock::now() + std::chrono::seconds(heartbeatInterval());
+            }
+        }
+
+        // 退出前把尚未发送的心跳发出去，避免调用方永远等待
+        if (!pending_.empty()) {
+            std::vector<PendingHeartbeat> batch;
+            batch.swap(pending_);
+            lock.unlock();
+            flushPending(batch);
+        }
+    }
+
+    ClientOptions opts_;
+    ConnectionPool pool_;
+    std::atomic<int> heartbeat_interval_{20};
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool running_{true};
+    std::vector<PendingHeartbeat> pending_;
+    std::chrono::steady_clock::time_point pending_since_;
+    std::unordered_set<std::string> tracked_;
+    std::function<void(const std::string&)> on_session_lost_;
+    std::thread worker_;
+};
+
+}  // namespace online
@@ -0,0 +1,168 @@
+// online_shm.h - 在线人数共享内存导出
+//
+// 服务端把 {count, version, timestamp} 发布到一页只读共享内存（默认 /dev/shm/online_count），
+// 同机进程映射后直接读取，不需要任何系统调用。读写之间用 seqlock 保证一致性。
+// 写端退出时不删除共享页，重启后沿用同一页继续发布，已打开的读端无需重新映射；
+// 读端可以用 timestamp_ms 判断写端是否仍在发布。
+// 同一页只允许一个写端：写端在整个生命周期内持有共享页 fd 上的排他 flock，
+// 同名页已被其它进程（另一个实例，或重启时尚未退出的旧进程）持有时 create() 失败。
+//
+// 读端示例：
+//     online_shm::Reader reader;
+//     if (reader.open()) {
+//         online_shm::Snapshot snap;
+//         if (reader.read(snap)) printf("%lld\n", (long long)snap.count);
+//     }
+#pragma once
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace online_shm {
+
+constexpr const char* kDefaultName = "/online_count";
+constexpr uint32_t kMagic = 0x434c4e4f;  // "ONLC"
+constexpr uint32_t kLayoutVersion = 1;
+
+// 共享页布局，写端唯一，seq 为奇数表示正在写
+struct alignas(64) CountPage {
+    uint32_t magic;
+    uint32_t layout_version;
+    std::atomic<uint32_t> seq;
+    uint32_t reserved;
+    std::atomic<int64_t> count;          // 在线人数
+    std::atomic<uint64_t> version;       // 每次发布加一
+    std::atomic<int64_t> timestamp_ms;   // 发布时间（Unix 毫秒）
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+struct Snapshot {
+    int64_t count = 0;
+    uint64_t version = 0;
+    int64_t timestamp_ms = 0;
+};
+
+class Reader {
+public:
+    Reader() = default;
+    ~Reader() { close(); }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    bool open(const char* name = kDefaultName) {
+        close();
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) return false;
+        void* mem = mmap(nullptr, sizeof(CountPage), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mem == MAP_FAILED) return false;
+
+        page_ = static_cast<const CountPage*>(mem);
+        if (page_->magic != kMagic || page_->layout_version != kLayoutVersion) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (page_ != nullptr) {
+            munmap(const_cast<CountPage*>(page_), sizeof(CountPage));
+            page_ = nullptr;
+        }
+    }
+
+    // 读取一致快照；写端恰好在写时自旋重试，最多 max_spins 次
+    bool read(Snapshot& out, int max_spins = 1000) const {
+        if (page_ == nullptr) return false;
+        for (int i = 0; i < max_spins; ++i) {
+            uint32_t begin = page_->seq.load(std::memory_order_acquire);
+            if (begin & 1) continue;
+            out.count = page_->count.load(std::memory_order_relaxed);
+            out.version = page_->version.load(std::memory_order_relaxed);
+            out.timestamp_ms = page_->timestamp_ms.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (page_->seq.load(std::memory_order_relaxed) == begin) return true;
+        }
+        return false;
+    }
+
+private:
+    const CountPage* page_ = nullptr;
+};
+
+// 写端，只允许一个线程（或在同一把锁内）调用 publish
+class Writer {
+public:
+    Writer() = default;
+    // 只解除映射并释放写锁，不 shm_unlink：删除后读端仍映射着孤立的旧页，会一直读到停住的人数
+    ~Writer() {
+        if (page_ != nullptr) munmap(page_, sizeof(CountPage));
+        if (lock_fd_ >= 0) ::close(lock_fd_);
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // 打开并锁定共享页；已有写端持有该页时返回 false
+    bool create(const std::string& name = kDefaultName) {
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        // 锁在 fd 关闭（包括进程崩溃）时自动释放，拿到锁即说明之前的写端都已退出
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0 || ftruncate(fd, sizeof(CountPage)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, sizeof(CountPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+
+        lock_fd_ = fd;
+        page_ = static_cast<CountPage*>(mem);
+        // 沿用旧页的 seq/version，已打开的读端不会看到版本回退
+        if (page_->magic != kMagic || page_->layout_version != kLayoutVersion) {
+            page_->seq.store(0, std::memory_order_relaxed);
+            page_->version.store(0, std::memory_order_relaxed);
+            page_->layout_version = kLayoutVersion;
+            std::atomic_thread_fence(std::memory_order_release);
+            page_->magic = kMagic;
+        } else {
+            // 持有写锁，上一个写端必然已退出：它在 publish 中途退出时 seq 停在奇数，
+            // 补成偶数，否则之后的奇偶含义颠倒
+            uint32_t seq = page_->seq.load(std::memory_order_relaxed);
+            if (seq & 1) page_->seq.store(seq + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    bool active() const { return page_ != nullptr; }
+
+    void publish(int64_t count, int64_t timestamp_ms) {
+        if (page_ == nullptr) return;
+        uint32_t seq = page_->seq.load(std::memory_order_relaxed);
+        page_->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        page_->count.store(count, std::memory_order_relaxed);
+        page_->version.store(page_->version.load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+        page_->timestamp_ms.store(timestamp_ms, std::memory_order_relaxed);
+        page_->seq.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    CountPage* page_ = nullptr;
+    int lock_fd_ = -1;   // 持有排他 flock 的共享页 fd
+};
+
+}  // namespace online_shm
@@ -0,0 +1,267 @@
+// profiler.h - 进程内 CPU 采样分析器
+//
+// 用 setitimer(ITIMER_PROF) 按进程 CPU 时间定时发送 SIGPROF，在信号处理函数中抓取被打断线程的调用栈，
+// 采样结束后符号化并输出 folded stacks（"a;b;c 次数"），可直接交给 flamegraph.pl。
+// 只有采样期间才启动定时器，不采样时不会产生信号，也没有任何额外开销。
+// ITIMER_PROF 在时钟中断里检查，到期时内核把 SIGPROF 投递给当时正在消耗 CPU 的线程，
+// 各版本内核都是如此；timer_create(CLOCK_PROCESS_CPUTIME_ID) 的信号在 6.4 之前的内核上
+// 优先发给主线程，而主线程阻塞在 accept，采样会集中在空闲线程上，因此不用它。
+#pragma once
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unwind.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CpuProfiler {
+public:
+    static constexpr int kMaxSeconds = 60;
+    static constexpr int kMaxHz = 1000;
+
+    struct Result {
+        std::string folded;     // folded stacks 文本
+        size_t samples = 0;     // 有效采样数
+        size_t dropped = 0;     // 缓冲区写满后丢弃的采样数
+    };
+
+    // 采样 seconds 秒，频率为每 CPU 秒 hz 次；已有采样在进行时返回 false
+    static bool profile(int seconds, int hz, Result& result) {
+        bool expected = false;
+        if (!busy_.compare_exchange_strong(expected, true)) {
+            return false;
+        }
+
+        seconds = std::clamp(seconds, 1, kMaxSeconds);
+        hz = std::clamp(hz, 1, kMaxHz);
+
+        // 缓冲区按最坏情况（所有核都满载）预估，上限 kMaxSamples
+        size_t capacity = static_cast<size_t>(seconds) * hz *
+                          std::max(1u, std::thread::hardware_concurrency());
+        capacity = std::min(capacity, kMaxSamples);
+        std::unique_ptr<Sample[]> buffer(new Sample[capacity]());
+        samples_ = buffer.get();
+        capacity_ = capacity;
+        next_.store(0);
+        dropped_.store(0);
+
+        // 预热 unwinder，首次调用可能分配内存，不能放在信号处理函数里
+        warmUp();
+
+        bool ok = start(hz);
+        if (ok) {
+            std::this_thread::sleep_for(std::chrono::seconds(seconds));
+            stop();
+            collect(result);
+        }
+
+        samples_ = nullptr;
+        capacity_ = 0;
+        busy_.store(false);
+        return ok;
+    }
+
+private:
+    static constexpr int kMaxDepth = 32;
+    static constexpr size_t kMaxSamples = 1 << 16;
+
+    struct Sample {
+        std::atomic<uint32_t> depth;   // 0 表示尚未写完
+        uintptr_t pcs[kMaxDepth];
+    };
+
+    struct UnwindState {
+        uintptr_t* pcs;
+        int depth;
+    };
+
+    static bool start(int hz) {
+        // 处理函数装上后不再卸载：定时器删除后仍可能有已排队的 SIGPROF，
+        // 恢复默认动作会直接终止进程；未启用时处理函数只读一个标志位
+        if (!installed_) {
+            struct sigaction sa{};
+            sa.sa_sigaction = &CpuProfiler::onSignal;
+            sa.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            if (sigaction(SIGPROF, &sa, nullptr) != 0) {
+                return false;
+            }
+            installed_ = true;
+        }
+
+        enabled_.store(true);
+        long interval_us = std::max(1L, 1000000L / hz);
+        itimerval its{};
+        its.it_interval.tv_sec = interval_us / 1000000L;
+        its.it_interval.tv_usec = interval_us % 1000000L;
+        its.it_value = its.it_interval;
+        if (setitimer(ITIMER_PROF, &its, nullptr) != 0) {
+            enabled_.store(false);
+            return false;
+        }
+        return true;
+    }
+
+    static void stop() {
+        enabled_.store(false);
+        itimerval off{};
+        setitimer(ITIMER_PROF, &off, nullptr);
+        // 等待仍在执行的信号处理函数退出，之后才能读取并释放采样缓冲区
+        while (in_handler_.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    static _Unwind_Reason_Code unwindCallback(_Unwind_Context* ctx, void* arg) {
+        auto* state = static_cast<UnwindState*>(arg);
+        if (state->depth >= kMaxDepth) {
+            return _URC_END_OF_STACK;
+        }
+        int before_insn = 0;
+        uintptr_t ip = _Unwind_GetIPInfo(ctx, &before_insn);
+        if (ip == 0) {
+            return _URC_END_OF_STACK;
+        }
+        // 返回地址指向调用指令的下一条，减一后落在调用指令内，符号化更准确
+        state->pcs[state->depth++] = before_insn ? ip : ip - 1;
+        return _URC_NO_REASON;
+    }
+
+    static uintptr_t interruptedPc(void* ucontext) {
+        auto* uc = static_cast<ucontext_t*>(ucontext);
+#if defined(__x86_64__)
+        return static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+        return static_cast<uintptr_t>(uc->uc_mcontext.pc);
+#else
+        (void)uc;
+        return 0;
+#endif
+    }
+
+    static void onSignal(int, siginfo_t*, void* ucontext) {
+        in_handler_.fetch_add(1);
+        int saved_errno = errno;
+
+        if (enabled_.load()) {
+            size_t idx = next_.fetch_add(1, std::memory_order_relaxed);
+            if (idx < capacity_) {
+                Sample& sample = samples_[idx];
+                UnwindState state{sample.pcs, 0};
+                _Unwind_Backtrace(&CpuProfiler::unwindCallback, &state);
+
+                // 丢掉信号处理函数自身和信号跳板帧，从被打断的指令开始
+                uintptr_t pc = interruptedPc(ucontext);
+                int begin = std::min(2, state.depth);
+                for (int i = 0; i < state.depth; ++i) {
+                    if (sample.pcs[i] == pc) {
+                        begin = i;
+                        break;
+                    }
+                }
+                if (begin > 0) {
+                    std::memmove(sample.pcs, sample.pcs + begin,
+                                 (state.depth - begin) * sizeof(uintptr_t));
+                }
+                sample.depth.store(static_cast<uint32_t>(state.depth - begin),
+                                   std::memory_order_release);
+            } else {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        errno = saved_errno;
+        in_handler_.fetch_sub(1);
+    }
+
+    static void warmUp() {
+        uintptr_t pcs[kMaxDepth];
+        UnwindState state{pcs, 0};
+        _Unwind_Backtrace(&CpuProfiler::unwindCallback, &state);
+    }
+
+    static std::string symbolize(uintptr_t pc) {
+        Dl_info info{};
+        if (dladdr(reinterpret_cast<void*>(pc), &info) != 0) {
+            if (info.dli_sname != nullptr) {
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                std::string name = (status == 0 && demangled) ? demangled : info.dli_sname;
+                std::free(demangled);
+                return name;
+            }
+            if (info.dli_fname != nullptr) {
+                const char* base = std::strrchr(info.dli_fname, '/');
+                char buf[64];
+                std::snprintf(buf, sizeof(buf), "+0x%lx",
+                              static_cast<unsigned long>(pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+                return std::string(base ? base + 1 : info.dli_fname) + buf;
+            }
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "0x%lx", static_cast<unsigned long>(pc));
+        return buf;
+    }
+
+    static void collect(Result& result) {
+        size_t total = std::min(next_.load(), capacity_);
+        std::map<std::string, size_t> stacks;
+        std::unordered_map<uintptr_t, std::string> symbols;
+
+        for (size_t i = 0; i < total; ++i) {
+            const Sample& sample = samples_[i];
+            uint32_t depth = sample.depth.load(std::memory_order_acquire);
+            if (depth == 0) continue;
+
+            // folded 格式从根到叶，';' 分隔；函数名中的 ';' 和空格会破坏格式，替换掉
+            std::string key;
+            for (int d = static_cast<int>(depth) - 1; d >= 0; --d) {
+                uintptr_t pc = sample.pcs[d];
+                auto it = symbols.find(pc);
+                if (it == symbols.end()) {
+                    std::string name = symbolize(pc);
+                    std::replace(name.begin(), name.end(), ';', ':');
+                    std::replace(name.begin(), name.end(), ' ', '_');
+                    it = symbols.emplace(pc, std::move(name)).first;
+                }
+                if (!key.empty()) key += ';';
+                key += it->second;
+            }
+            ++stacks[key];
+            ++result.samples;
+        }
+
+        result.dropped = dropped_.load();
+        for (const auto& [stack, count] : stacks) {
+            result.folded += stack;
+            result.folded += ' ';
+            result.folded += std::to_string(count);
+            result.folded += '\n';
+        }
+    }
+
+    static inline std::atomic<bool> busy_{false};
+    static inline std::atomic<bool> enabled_{false};
+    static inline std::atomic<int> in_handler_{0};
+    static inline std::atomic<size_t> next_{0};
+    static inline std::atomic<size_t> dropped_{0};
+    static inline Sample* samples_ = nullptr;
+    static inline size_t capacity_ = 0;
+    static inline bool installed_ = false;
+};
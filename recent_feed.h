@@ -0,0 +1,61 @@
+// recent_feed.h - 最近上线用户列表
+//
+// 按登录时间从新到旧排列的双向链表，每个用户只出现一次：
+// 再次登录时移到表头，用户下线时立即移除，超过容量时从表尾淘汰。
+// 取最近 k 个只需从表头走 k 步。非线程安全，由调用方加锁。
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class RecentFeed {
+public:
+    struct Item {
+        std::string user_id;
+        int64_t login_ms = 0;   // 最近一次登录时间（Unix 毫秒）
+    };
+
+    explicit RecentFeed(size_t capacity) : capacity_(capacity) {}
+
+    // 记录一次登录，已存在的用户移到表头
+    void touch(const std::string& user_id, int64_t login_ms) {
+        auto it = index_.find(user_id);
+        if (it != index_.end()) {
+            it->second->login_ms = login_ms;
+            items_.splice(items_.begin(), items_, it->second);
+            return;
+        }
+
+        items_.push_front({user_id, login_ms});
+        index_.emplace(user_id, items_.begin());
+        if (items_.size() > capacity_) {
+            index_.erase(items_.back().user_id);
+            items_.pop_back();
+        }
+    }
+
+    void remove(const std::string& user_id) {
+        auto it = index_.find(user_id);
+        if (it == index_.end()) return;
+        items_.erase(it->second);
+        index_.erase(it);
+    }
+
+    std::vector<Item> recent(size_t k) const {
+        std::vector<Item> result;
+        result.reserve(std::min(k, items_.size()));
+        for (auto it = items_.begin(); it != items_.end() && result.size() < k; ++it) {
+            result.push_back(*it);
+        }
+        return result;
+    }
+
+private:
+    size_t capacity_;
+    std::list<Item> items_;
+    std::unordered_map<std::string, std::list<Item>::iterator> index_;
+};
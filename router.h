@@ -0,0 +1,74 @@
+// router.h - 路由表
+//
+// 路由先登记在这里，再挂到各个监听上：HTTP/1.1 与 HTTPS 监听通过 mount() 注册到
+// httplib，h2c 监听通过 dispatch() 按方法和路径直接查表调用，保证所有监听执行同一份处理函数。
+// 路径按字面精确匹配。注册阶段之后只读，可多线程并发 dispatch。
+// 中间件在登记时包装处理函数，对之后登记的路由生效，各监听因此共享同一层包装。
+#pragma once
+
+#include <httplib.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Router {
+public:
+    using Handler = std::function<void(const httplib::Request&, httplib::Response&)>;
+    using Middleware = std::function<Handler(const std::string& method, const std::string& path, Handler)>;
+
+    // 设置中间件，须在登记路由之前调用
+    Router& use(Middleware middleware) {
+        middleware_ = std::move(middleware);
+        return *this;
+    }
+
+    Router& Get(const std::string& path, Handler handler) {
+        return add("GET", path, std::move(handler));
+    }
+
+    Router& Post(const std::string& path, Handler handler) {
+        return add("POST", path, std::move(handler));
+    }
+
+    // 注册到 httplib 监听
+    void mount(httplib::Server& server) const {
+        for (const auto& route : routes_) {
+            if (route.method == "GET") {
+                server.Get(route.path, route.handler);
+            } else {
+                server.Post(route.path, route.handler);
+            }
+        }
+    }
+
+    // 调用匹配的处理函数；没有匹配的路由时返回 false
+    bool dispatch(const httplib::Request& req, httplib::Response& res) const {
+        auto it = index_.find(req.method + ' ' + req.path);
+        if (it == index_.end()) return false;
+        routes_[it->second].handler(req, res);
+        return true;
+    }
+
+    struct Route {
+        std::string method;
+        std::string path;
+        Handler handler;
+    };
+
+    const std::vector<Route>& routes() const { return routes_; }
+
+private:
+    Router& add(const std::string& method, const std::string& path, Handler handler) {
+        if (middleware_) handler = middleware_(method, path, std::move(handler));
+        index_[method + ' ' + path] = routes_.size();
+        routes_.push_back({method, path, std::move(handler)});
+        return *this;
+    }
+
+    std::vector<Route> routes_;
+    std::unordered_map<std::string, size_t> index_;
+    Middleware middleware_;
+};
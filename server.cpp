@@ -1,33 +1,178 @@
 // server.cpp - 在线人数统计服务器
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include <sys/stat.h>
 #include <iostream>
 #include <mutex>
 #include <unordered_set>
 #include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <fstream>
 #include <thread>
 #include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <memory>
+#include <optional>
 #include <random>
 #include <vector>
 
+#include "activity_window.h"
+#include "arrow_stream.h"
+#include "cpu_accounting.h"
+#include "h2c_server.h"
+#include "last_seen_store.h"
+#include "online_shm.h"
+#include "profiler.h"
+#include "recent_feed.h"
+#include "router.h"
+#include "session_index.h"
+#include "session_meta.h"
+#include "spatial_index.h"
+
 using json = nlohmann::json;
 
+// 会话超时时间（秒），超过该时间无心跳视为下线
+static constexpr int kSessionTimeoutSec = 60;
+// 下发给客户端的心跳间隔（秒），保证超时前至少有两次心跳机会
+static constexpr int kHeartbeatIntervalSec = 20;
+
+// 读取整数环境变量，未设置或非法时返回默认值
+static long envLong(const char* name, long default_value) {
+    const char* value = std::getenv(name);
+    if (value == nullptr || *value == '\0') return default_value;
+    char* end = nullptr;
+    long parsed = std::strtol(value, &end, 10);
+    return (end != nullptr && *end == '\0') ? parsed : default_value;
+}
+
+static std::string envString(const char* name, const std::string& default_value = "") {
+    const char* value = std::getenv(name);
+    return value != nullptr ? value : default_value;
+}
+
+// 服务配置，均可通过环境变量覆盖
+struct OnlineConfig {
+    size_t last_seen_capacity = 1 << 20;  // 最后在线时间表容量（用户数）
+    std::string last_seen_file;           // 非空时最后在线时间表映射到该文件
+    std::string shm_name = online_shm::kDefaultName;  // 在线人数共享内存名，置空则不导出
+    double geo_cell_deg = 0.01;           // 空间索引网格边长（度），约 1.1 公里
+    size_t recent_capacity = 10000;       // 最近上线列表保留的用户数
+    int resume_grace_sec = 120;           // 过期会话挂起多久内可凭原会话ID恢复，0 表示不挂起
+    std::string resume_file;              // 非空时退出前保存会话，重启后作为挂起会话加载
+    
+    static OnlineConfig fromEnv() {
+        OnlineConfig config;
+        config.last_seen_capacity = static_cast<size_t>(
+            envLong("ONLINE_LASTSEEN_CAPACITY", static_cast<long>(config.last_seen_capacity)));
+        config.last_seen_file = envString("ONLINE_LASTSEEN_FILE");
+        config.shm_name = envString("ONLINE_SHM_NAME", config.shm_name);
+        config.recent_capacity = static_cast<size_t>(
+            envLong("ONLINE_RECENT_CAPACITY", static_cast<long>(config.recent_capacity)));
+        config.resume_grace_sec = static_cast<int>(
+            envLong("ONLINE_RESUME_GRACE_SEC", config.resume_grace_sec));
+        config.resume_file = envString("ONLINE_RESUME_FILE");
+        long cell_mdeg = envLong("ONLINE_GEO_CELL_MDEG", 0);  // 千分之一度
+        if (cell_mdeg > 0) config.geo_cell_deg = cell_mdeg / 1000.0;
+        return config;
+    }
+};
+
+// HTTPS 监听配置，证书和私钥都设置时启用
+struct TlsConfig {
+    std::string cert_file;              // PEM 证书链
+    std::string key_file;               // PEM 私钥
+    int port = 8443;
+    bool ktls = true;                   // 内核支持时把记录层加解密交给内核（kTLS）
+    int session_timeout_sec = 3600;     // 会话票据和会话缓存的有效期，断线重连在此期间免完整握手
+    std::string ticket_key_file;        // 80 字节票据密钥，多实例共享同一文件后可跨实例恢复会话
+    
+    bool enabled() const { return !cert_file.empty() && !key_file.empty(); }
+    
+    static TlsConfig fromEnv() {
+        TlsConfig config;
+        config.cert_file = envString("ONLINE_TLS_CERT");
+        config.key_file = envString("ONLINE_TLS_KEY");
+        config.port = static_cast<int>(envLong("ONLINE_TLS_PORT", config.port));
+        config.ktls = envLong("ONLINE_TLS_KTLS", 1) != 0;
+        config.session_timeout_sec = static_cast<int>(
+            envLong("ONLINE_TLS_SESSION_TIMEOUT", config.session_timeout_sec));
+        config.ticket_key_file = envString("ONLINE_TLS_TICKET_KEY_FILE");
+        return config;
+    }
+};
+
+static int64_t unixMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t unixSeconds() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// 登录时上报的客户端信息，只写入元数据表，不影响在线统计
+struct ClientInfo {
+    std::string ip;             // 连接的对端地址
+    std::string platform;       // ios / android / web ...
+    std::string app_version;    // major.minor.patch
+};
+
 class OnlineManager {
 private:
     // 将 mutex 声明为 mutable，这样可以在 const 成员函数中锁定
     mutable std::mutex mtx_;
-    std::unordered_set<std::string> online_users_;  // 在线用户ID集合
+    std::unordered_map<std::string, int> online_users_;  // 在线用户ID -> 会话数
     
     // 清理过期连接
     struct SessionInfo {
-        std::string session_id;
+        std::string session_id;         // 空表示空闲槽
         std::string user_id;
         std::chrono::steady_clock::time_point last_active;
+        std::string room_id;            // 所在房间，空表示不在任何房间
+    };
+    
+    // 会话按槽存放，槽号在会话存续期间不变；索引只记录会话ID到槽号的映射
+    struct SlotKey {
+        const std::vector<SessionInfo>* slots;
+        const std::string& operator()(uint32_t slot) const { return (*slots)[slot].session_id; }
     };
-    std::unordered_map<std::string, SessionInfo> sessions_;
+    using Index = SessionIndex<SlotKey>;
+    static constexpr uint32_t kNoSlot = Index::kNotFound;
+    
+    std::vector<SessionInfo> slots_;
+    std::vector<uint32_t> free_slots_;
+    Index index_{SlotKey{&slots_}};
+    SessionMetaTable meta_;             // 会话元数据，与 slots_ 同下标
+    
+    // 挂起的会话：心跳超时后在宽限期内保留，不计入任何在线统计，心跳到来即恢复
+    struct SuspendedSession {
+        std::string user_id;
+        std::string room_id;
+        std::chrono::steady_clock::time_point deadline;
+        SessionMeta meta;
+        std::optional<GeoPoint> location;   // 挂起前最后上报的坐标，恢复时重新登记到空间索引
+    };
+    std::unordered_map<std::string, SuspendedSession> suspended_;
+    
+    // 房间在线用户：房间ID -> (用户ID -> 该用户在房间内的会话数)
+    std::unordered_map<std::string, std::unordered_map<std::string, int>> rooms_;
+    
+    ActivityWindow activity_;           // 最近 N 分钟活跃统计
+    LastSeenStore last_seen_;           // 离线用户最后在线时间（自带锁）
+    online_shm::Writer shm_;            // 在线人数共享内存页，在 mtx_ 内发布
+    SpatialIndex spatial_;              // 上报了坐标的会话的空间索引
+    RecentFeed recent_;                 // 最近上线的在线用户，新到旧
     
     std::atomic<int> total_online_{0};  // 总在线人数
+    std::chrono::seconds resume_grace_;
+    std::string resume_file_;
+    
+    std::mutex cleanup_mtx_;
+    std::condition_variable cleanup_cv_;
     bool running_{true};
     std::thread cleanup_thread_;
     
@@ -37,64 +182,192 @@ private:
     std::uniform_int_distribution<> dis_;
     
 public:
-    OnlineManager() : gen_(rd_()), dis_(1000, 9999) {
-        // 启动清理线程
+    explicit OnlineManager(const OnlineConfig& config = OnlineConfig())
+        : last_seen_(config.last_seen_capacity, config.last_seen_file),
+          spatial_(config.geo_cell_deg),
+          recent_(config.recent_capacity),
+          resume_grace_(std::max(0, config.resume_grace_sec)),
+          resume_file_(config.resume_file),
+          gen_(rd_()), dis_(1000, 9999) {
+        if (!config.shm_name.empty() && !shm_.create(config.shm_name)) {
+            std::cerr << "shared memory export disabled: cannot create " << config.shm_name
+                      << " (or another server is already publishing to it)\n";
+        }
+        shm_.publish(0, unixMillis());
+        loadResumeFile();
+        
+        // 启动清理线程，析构时通过条件变量立即唤醒退出
         cleanup_thread_ = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(cleanup_mtx_);
             while (running_) {
-                cleanupExpiredSessions();
-                std::this_thread::sleep_for(std::chrono::seconds(30));
+                lock.unlock();
+                {
+                    CpuAccounting::Task task("sweep");
+                    cleanupExpiredSessions();
+                }
+                lock.lock();
+                cleanup_cv_.wait_for(lock, std::chrono::seconds(30), [this]() { return !running_; });
             }
         });
     }
     
     ~OnlineManager() {
-        running_ = false;
+        {
+            std::lock_guard<std::mutex> lock(cleanup_mtx_);
+            running_ = false;
+        }
+        cleanup_cv_.notify_all();
         if (cleanup_thread_.joinable()) {
             cleanup_thread_.join();
         }
+        saveResumeFile();
     }
     
-    // 用户上线
-    std::string userLogin(const std::string& user_id) {
+    // 用户上线，可选携带坐标、初始房间和客户端信息
+    std::string userLogin(const std::string& user_id,
+                          const std::optional<GeoPoint>& location = std::nullopt,
+                          const std::string& room_id = "",
+                          const ClientInfo& client = ClientInfo()) {
         std::lock_guard<std::mutex> lock(mtx_);
         
-        // 生成唯一会话ID
-        std::string session_id = generateSessionId();
+        // 生成唯一会话ID；同一毫秒内随机数可能重复，与现有和挂起的会话冲突时重新生成
+        std::string session_id;
+        do {
+            session_id = generateSessionId();
+        } while (index_.find(session_id) != kNoSlot || suspended_.count(session_id) > 0);
+        auto now = std::chrono::steady_clock::now();
         
-        online_users_.insert(user_id);
-        sessions_[session_id] = {
+        ++online_users_[user_id];
+        uint32_t slot = insertSession({
             session_id,
             user_id,
-            std::chrono::steady_clock::now()
-        };
+            now,
+            room_id
+        });
+        meta_.set(slot, {
+            unixMillis(),
+            SessionMetaTable::parseIpv4(client.ip),
+            SessionMetaTable::parseVersion(client.app_version),
+            meta_.platformCode(client.platform)
+        });
+        joinRoom(room_id, user_id);
+        activity_.recordLogin(user_id, now);
+        recent_.touch(user_id, unixMillis());
+        if (location) {
+            spatial_.update(session_id, user_id, *location);
+        }
         
-        total_online_ = static_cast<int>(online_users_.size());
+        updateTotal();
         
         return session_id;
     }
     
-    // 用户心跳（保持在线状态）
-    bool userHeartbeat(const std::string& session_id) {
+    // 用户心跳（保持在线状态），可选携带最新坐标
+    bool userHeartbeat(const std::string& session_id,
+                       const std::optional<GeoPoint>& location = std::nullopt) {
         std::lock_guard<std::mutex> lock(mtx_);
+        auto now = std::chrono::steady_clock::now();
         
-        auto it = sessions_.find(session_id);
-        if (it != sessions_.end()) {
-            it->second.last_active = std::chrono::steady_clock::now();
+        SessionInfo* session = findOrResume(session_id, now);
+        if (session != nullptr) {
+            session->last_active = now;
+            activity_.recordHeartbeat(session->user_id, now);
+            if (location) {
+                spatial_.update(session_id, session->user_id, *location);
+            }
             return true;
         }
         return false;
     }
     
+    // 批量心跳：锁外算哈希，锁内用预取流水线批量查找，结果与输入一一对应
+    std::vector<bool> userHeartbeatBatch(const std::vector<std::string>& session_ids) {
+        std::vector<bool> results(session_ids.size(), false);
+        std::vector<uint32_t> slots(session_ids.size());
+        std::vector<uint64_t> hashes(session_ids.size());
+        Index::hashBatch(session_ids.data(), session_ids.size(), hashes.data());
+        auto now = std::chrono::steady_clock::now();
+        
+        std::lock_guard<std::mutex> lock(mtx_);
+        index_.findBatch(session_ids.data(), hashes.data(), session_ids.size(), slots.data());
+        for (size_t i = 0; i < session_ids.size(); ++i) {
+            // 未命中的可能是挂起会话，走逐个查找并尝试恢复
+            SessionInfo* session = slots[i] != kNoSlot ? &slots_[slots[i]]
+                                                       : findOrResume(session_ids[i], now);
+            if (session != nullptr) {
+                session->last_active = now;
+                activity_.recordHeartbeat(session->user_id, now);
+                results[i] = true;
+            }
+        }
+        return results;
+    }
+    
     // 用户下线
     void userLogout(const std::string& session_id) {
         std::lock_guard<std::mutex> lock(mtx_);
         
-        auto it = sessions_.find(session_id);
-        if (it != sessions_.end()) {
-            online_users_.erase(it->second.user_id);
-            sessions_.erase(it);
-            total_online_ = static_cast<int>(online_users_.size());
+        uint32_t slot = index_.find(session_id);
+        if (slot != kNoSlot) {
+            SessionInfo& session = slots_[slot];
+            releaseUser(session.user_id, unixSeconds());
+            leaveRoom(session.room_id, session.user_id);
+            spatial_.remove(session_id);
+            eraseSession(slot);
+            updateTotal();
+        } else {
+            suspended_.erase(session_id);
+        }
+    }
+    
+    // 切换房间：同一临界区内离开旧房间、进入新房间并续期会话，不会出现中间态
+    struct RoomMove {
+        bool success = false;
+        std::string from_room;
+        int from_count = 0;
+        int to_count = 0;
+    };
+    
+    RoomMove moveRoom(const std::string& session_id, const std::string& room_id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        RoomMove result;
+        auto now = std::chrono::steady_clock::now();
+        
+        SessionInfo* found = findOrResume(session_id, now);
+        if (found == nullptr) {
+            return result;
+        }
+        
+        SessionInfo& session = *found;
+        session.last_active = now;
+        result.success = true;
+        result.from_room = session.room_id;
+        if (session.room_id != room_id) {
+            leaveRoom(session.room_id, session.user_id);
+            joinRoom(room_id, session.user_id);
+            session.room_id = room_id;
         }
+        result.from_count = roomCount(result.from_room);
+        result.to_count = roomCount(room_id);
+        return result;
+    }
+    
+    int getRoomCount(const std::string& room_id) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return roomCount(room_id);
+    }
+    
+    std::vector<std::string> getRoomUsers(const std::string& room_id) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<std::string> users;
+        auto it = rooms_.find(room_id);
+        if (it != rooms_.end()) {
+            users.reserve(it->second.size());
+            for (const auto& entry : it->second) {
+                users.push_back(entry.first);
+            }
+        }
+        return users;
     }
     
     // 获取在线人数
@@ -105,13 +378,182 @@ public:
     // 获取在线用户列表
     std::vector<std::string> getOnlineUsers() const {
         std::lock_guard<std::mutex> lock(mtx_);
-        return std::vector<std::string>(online_users_.begin(), online_users_.end());
+        std::vector<std::string> users;
+        users.reserve(online_users_.size());
+        for (const auto& entry : online_users_) {
+            users.push_back(entry.first);
+        }
+        return users;
+    }
+    
+    // 最近上线的 k 个在线用户，按登录时间从新到旧
+    std::vector<RecentFeed::Item> getRecentUsers(size_t k) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return recent_.recent(k);
+    }
+    
+    // 用户在线状态与最后在线时间（Unix 秒）；在线用户或从未记录过的用户 last_seen 为空
+    struct LastSeen {
+        bool online = false;
+        std::optional<uint32_t> last_seen;
+    };
+    
+    std::vector<LastSeen> getLastSeen(const std::vector<std::string>& user_ids) {
+        std::vector<LastSeen> results(user_ids.size());
+        std::vector<std::string> offline;
+        std::vector<size_t> offline_index;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (size_t i = 0; i < user_ids.size(); ++i) {
+                if (online_users_.count(user_ids[i]) > 0) {
+                    results[i].online = true;
+                } else {
+                    offline.push_back(user_ids[i]);
+                    offline_index.push_back(i);
+                }
+            }
+        }
+        
+        auto found = last_seen_.lookupBatch(offline);
+        for (size_t i = 0; i < found.size(); ++i) {
+            results[offline_index[i]].last_seen = found[i];
+        }
+        return results;
+    }
+    
+    // 最近 5 / 15 / 60 分钟的活跃统计
+    std::vector<ActivityWindow::WindowStats> getActivityStats() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return activity_.snapshot(std::chrono::steady_clock::now());
+    }
+    
+    // 附近在线用户：k > 0 时返回 radius_m 内最近的 k 个，否则返回 radius_m 内的最多 limit 个
+    std::vector<SpatialIndex::Hit> getNearby(const GeoPoint& center, double radius_m,
+                                             size_t k, size_t limit) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (k > 0) {
+            return spatial_.nearest(center, k, radius_m);
+        }
+        return spatial_.withinRadius(center, radius_m, limit);
     }
     
     // 检查会话是否有效
     bool isValidSession(const std::string& session_id) const {
         std::lock_guard<std::mutex> lock(mtx_);
-        return sessions_.find(session_id) != sessions_.end();
+        return index_.find(session_id) != kNoSlot;
+    }
+    
+    // 批量检查会话有效性（不续期、不恢复挂起会话）
+    std::vector<bool> validateBatch(const std::vector<std::string>& session_ids) const {
+        auto slots = lookupBatch(session_ids);
+        std::vector<bool> results(slots.size());
+        for (size_t i = 0; i < slots.size(); ++i) {
+            results[i] = slots[i] != kNoSlot;
+        }
+        return results;
+    }
+    
+    // 过滤出有效会话，返回 (会话ID, 用户ID)
+    std::vector<std::pair<std::string, std::string>> filterSessions(
+            const std::vector<std::string>& session_ids) const {
+        std::vector<uint64_t> hashes(session_ids.size());
+        std::vector<uint32_t> slots(session_ids.size());
+        Index::hashBatch(session_ids.data(), session_ids.size(), hashes.data());
+        
+        std::vector<std::pair<std::string, std::string>> valid;
+        std::lock_guard<std::mutex> lock(mtx_);
+        index_.findBatch(session_ids.data(), hashes.data(), session_ids.size(), slots.data());
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i] != kNoSlot) {
+                valid.emplace_back(session_ids[i], slots_[slots[i]].user_id);
+            }
+        }
+        return valid;
+    }
+    
+    // 按元数据条件查询活跃会话；platform 非空时按平台名过滤
+    struct SessionRecord {
+        std::string session_id;
+        std::string user_id;
+        std::string ip;
+        std::string platform;
+        std::string app_version;
+        int64_t login_ms = 0;
+    };
+    
+    struct SessionQuery {
+        size_t total = 0;                   // 匹配的会话总数
+        std::vector<SessionRecord> sessions;  // 最多 limit 条
+    };
+    
+    SessionQuery querySessions(SessionMetaTable::Filter filter, const std::string& platform,
+                               size_t limit) const {
+        SessionQuery result;
+        std::vector<uint32_t> slots;
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!platform.empty()) {
+            filter.platform = meta_.findPlatform(platform);
+            if (!filter.platform) return result;
+        }
+        
+        result.total = meta_.scan(filter, limit, slots);
+        result.sessions.reserve(slots.size());
+        for (uint32_t slot : slots) {
+            SessionMeta meta = meta_.get(slot);
+            result.sessions.push_back({
+                slots_[slot].session_id,
+                slots_[slot].user_id,
+                SessionMetaTable::formatIpv4(meta.ipv4),
+                meta_.platformName(meta.platform),
+                SessionMetaTable::formatVersion(meta.app_version),
+                meta.login_ms
+            });
+        }
+        return result;
+    }
+    
+    // 导出的列，顺序与 exportSessions 的写入顺序一致
+    static std::vector<arrow_stream::Field> exportSchema() {
+        using arrow_stream::Type;
+        return {
+            {"session_id", Type::kUtf8},
+            {"user_id", Type::kUtf8},
+            {"room_id", Type::kUtf8},
+            {"login_time", Type::kTimestampMs},
+            {"last_active", Type::kTimestampMs},
+            {"ipv4", Type::kUInt32},
+            {"platform", Type::kUtf8},
+            {"app_version", Type::kUtf8},
+        };
+    }
+    
+    // 从 cursor 槽起把至多 max_rows 个活跃会话追加到 batch，并把 cursor 推进到下一批的起点
+    // 每批单独持锁拷贝，锁的持有时间只与 max_rows 有关；批与批之间会话可能变化，
+    // 导出期间一直在线的会话恰好出现一次。返回是否还有未导出的槽
+    bool exportSessions(uint32_t& cursor, size_t max_rows, arrow_stream::BatchBuilder& batch) const {
+        int64_t now_ms = unixMillis();
+        auto now = std::chrono::steady_clock::now();
+        
+        std::lock_guard<std::mutex> lock(mtx_);
+        size_t rows = 0;
+        for (; cursor < slots_.size() && rows < max_rows; ++cursor) {
+            const SessionInfo& session = slots_[cursor];
+            if (session.session_id.empty()) continue;
+            SessionMeta meta = meta_.get(cursor);
+            int64_t idle_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - session.last_active).count();
+            batch.addString(0, session.session_id);
+            batch.addString(1, session.user_id);
+            batch.addString(2, session.room_id);
+            batch.addInt64(3, meta.login_ms);
+            batch.addInt64(4, now_ms - idle_ms);
+            batch.addUInt32(5, meta.ipv4);
+            batch.addString(6, meta_.platformName(meta.platform));
+            batch.addString(7, SessionMetaTable::formatVersion(meta.app_version));
+            batch.endRow();
+            ++rows;
+        }
+        return cursor < slots_.size();
     }
     
 private:
@@ -125,41 +567,349 @@ private:
         return "sess_" + std::to_string(timestamp) + "_" + std::to_string(random_num);
     }
     
+    // 会话槽维护，调用方需持有 mtx_
+    uint32_t insertSession(SessionInfo info) {
+        uint32_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+            slots_[slot] = std::move(info);
+        } else {
+            slot = static_cast<uint32_t>(slots_.size());
+            slots_.push_back(std::move(info));
+        }
+        index_.insert(slots_[slot].session_id, slot);
+        return slot;
+    }
+    
+    void eraseSession(uint32_t slot) {
+        index_.erase(slots_[slot].session_id);
+        meta_.clear(slot);
+        slots_[slot] = SessionInfo{};
+        free_slots_.push_back(slot);
+    }
+    
+    std::vector<uint32_t> lookupBatch(const std::vector<std::string>& session_ids) const {
+        std::vector<uint64_t> hashes(session_ids.size());
+        std::vector<uint32_t> slots(session_ids.size());
+        Index::hashBatch(session_ids.data(), session_ids.size(), hashes.data());
+        
+        std::lock_guard<std::mutex> lock(mtx_);
+        index_.findBatch(session_ids.data(), hashes.data(), session_ids.size(), slots.data());
+        return slots;
+    }
+    
+    // 查找会话；不在活跃表但仍在挂起宽限期内时原样恢复（沿用会话ID、用户和房间）
+    // 调用方需持有 mtx_
+    SessionInfo* findOrResume(const std::string& session_id,
+                              std::chrono::steady_clock::time_point now) {
+        uint32_t slot = index_.find(session_id);
+        if (slot != kNoSlot) {
+            return &slots_[slot];
+        }
+        
+        auto suspended = suspended_.find(session_id);
+        if (suspended == suspended_.end() || suspended->second.deadline < now) {
+            return nullptr;
+        }
+        
+        slot = insertSession({session_id, std::move(suspended->second.user_id), now,
+                              std::move(suspended->second.room_id)});
+        meta_.set(slot, suspended->second.meta);
+        std::optional<GeoPoint> location = suspended->second.location;
+        suspended_.erase(suspended);
+        SessionInfo& session = slots_[slot];
+        
+        if (++online_users_[session.user_id] == 1) {
+            recent_.touch(session.user_id, unixMillis());
+        }
+        joinRoom(session.room_id, session.user_id);
+        if (location) {
+            spatial_.update(session_id, session.user_id, *location);
+        }
+        updateTotal();
+        return &session;
+    }
+    
+    // 房间成员维护，调用方需持有 mtx_；空房间ID表示不在房间
+    void joinRoom(const std::string& room_id, const std::string& user_id) {
+        if (room_id.empty()) return;
+        ++rooms_[room_id][user_id];
+    }
+    
+    void leaveRoom(const std::string& room_id, const std::string& user_id) {
+        if (room_id.empty()) return;
+        auto room = rooms_.find(room_id);
+        if (room == rooms_.end()) return;
+        auto user = room->second.find(user_id);
+        if (user != room->second.end() && --user->second <= 0) {
+            room->second.erase(user);
+        }
+        if (room->second.empty()) {
+            rooms_.erase(room);
+        }
+    }
+    
+    int roomCount(const std::string& room_id) const {
+        if (room_id.empty()) return 0;
+        auto it = rooms_.find(room_id);
+        return it == rooms_.end() ? 0 : static_cast<int>(it->second.size());
+    }
+    
+    // 刷新在线人数并发布到共享内存，调用方需持有 mtx_
+    void updateTotal() {
+        total_online_ = static_cast<int>(online_users_.size());
+        shm_.publish(total_online_.load(), unixMillis());
+    }
+    
+    // 会话结束时减少用户会话数，最后一个会话结束时用户下线并记录最后在线时间
+    void releaseUser(const std::string& user_id, uint32_t now) {
+        auto it = online_users_.find(user_id);
+        if (it == online_users_.end()) return;
+        if (--it->second <= 0) {
+            online_users_.erase(it);
+            recent_.remove(user_id);
+            last_seen_.update(user_id, now);
+        }
+    }
+    
+    // 退出前保存活跃和挂起的会话，重启后统一作为挂起会话加载
+    // 每个会话一行：[会话ID, 用户ID, 房间ID, 登录毫秒, IPv4, 平台, 版本(, 纬度, 经度)]，坐标只在上报过时写出
+    void saveResumeFile() {
+        if (resume_file_.empty() || resume_grace_.count() == 0) return;
+        CpuAccounting::Task task("export.resume_file");
+        
+        json sessions = json::array();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto record = [&](const std::string& session_id, const std::string& user_id,
+                              const std::string& room_id, const SessionMeta& meta,
+                              const std::optional<GeoPoint>& location) {
+                json item = {session_id, user_id, room_id, meta.login_ms,
+                             meta.ipv4, meta_.platformName(meta.platform), meta.app_version};
+                if (location) {
+                    item.push_back(location->lat);
+                    item.push_back(location->lon);
+                }
+                sessions.push_back(std::move(item));
+            };
+            for (uint32_t slot = 0; slot < slots_.size(); ++slot) {
+                const SessionInfo& session = slots_[slot];
+                if (session.session_id.empty()) continue;
+                record(session.session_id, session.user_id, session.room_id, meta_.get(slot),
+                       spatial_.location(session.session_id));
+            }
+            for (const auto& entry : suspended_) {
+                record(entry.first, entry.second.user_id, entry.second.room_id, entry.second.meta,
+                       entry.second.location);
+            }
+        }
+        
+        std::string tmp = resume_file_ + ".tmp";
+        std::ofstream out(tmp, std::ios::trunc);
+        out << sessions.dump();
+        out.close();
+        if (!out || std::rename(tmp.c_str(), resume_file_.c_str()) != 0) {
+            std::cerr << "failed to save sessions to " << resume_file_ << "\n";
+        }
+    }
+    
+    // 加载后不删除文件：启动失败（如端口绑定失败）时会话不会丢，下次保存时原子替换。
+    // 宽限期从文件写入时刻算起，停机超过宽限期后留下的旧文件不再加载
+    void loadResumeFile() {
+        if (resume_file_.empty() || resume_grace_.count() == 0) return;
+        
+        struct stat st{};
+        if (stat(resume_file_.c_str(), &st) != 0) return;
+        auto age = std::chrono::seconds(std::max<int64_t>(0, static_cast<int64_t>(unixSeconds()) - st.st_mtime));
+        if (age >= resume_grace_) {
+            std::cout << "Skipping stale resume file " << resume_file_ << "\n";
+            return;
+        }
+        
+        std::ifstream in(resume_file_);
+        if (!in) return;
+        try {
+            auto sessions = json::parse(in);
+            auto deadline = std::chrono::steady_clock::now() + (resume_grace_ - age);
+            for (const auto& item : sessions) {
+                SessionMeta meta;
+                std::optional<GeoPoint> location;
+                if (item.size() >= 7) {  // 旧格式只有前三列
+                    meta = {item.at(3).get<int64_t>(), item.at(4).get<uint32_t>(),
+                            item.at(6).get<uint32_t>(),
+                            meta_.platformCode(item.at(5).get<std::string>())};
+                }
+                if (item.size() >= 9) {
+                    GeoPoint point{item.at(7).get<double>(), item.at(8).get<double>()};
+                    if (point.valid()) location = point;
+                }
+                suspended_[item.at(0).get<std::string>()] = {
+                    item.at(1).get<std::string>(), item.at(2).get<std::string>(), deadline, meta, location};
+            }
+            std::cout << "Loaded " << suspended_.size() << " resumable sessions from "
+                      << resume_file_ << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << "ignoring invalid resume file " << resume_file_ << ": " << e.what() << "\n";
+        }
+    }
+    
     void cleanupExpiredSessions() {
         std::lock_guard<std::mutex> lock(mtx_);
         auto now = std::chrono::steady_clock::now();
+        uint32_t now_unix = unixSeconds();
         
-        for (auto it = sessions_.begin(); it != sessions_.end(); ) {
+        for (uint32_t slot = 0; slot < slots_.size(); ++slot) {
+            SessionInfo& session = slots_[slot];
+            if (session.session_id.empty()) continue;
             auto duration = std::chrono::duration_cast<std::chrono::seconds>(
-                now - it->second.last_active);
+                now - session.last_active);
             
-            // 60秒无心跳视为过期
-            if (duration.count() > 60) {
-                online_users_.erase(it->second.user_id);
-                it = sessions_.erase(it);
+            // 超过超时时间无心跳视为过期
+            if (duration.count() > kSessionTimeoutSec) {
+                releaseUser(session.user_id, now_unix);
+                leaveRoom(session.room_id, session.user_id);
+                if (resume_grace_.count() > 0) {
+                    suspended_[session.session_id] = {session.user_id, session.room_id,
+                                                      now + resume_grace_, meta_.get(slot),
+                                                      spatial_.location(session.session_id)};
+                }
+                spatial_.remove(session.session_id);
+                eraseSession(slot);
+            }
+        }
+        
+        // 超过宽限期的挂起会话彻底删除
+        for (auto it = suspended_.begin(); it != suspended_.end(); ) {
+            if (it->second.deadline < now) {
+                it = suspended_.erase(it);
             } else {
                 ++it;
             }
         }
         
-        total_online_ = static_cast<int>(online_users_.size());
+        updateTotal();
     }
 };
 
-int main() {
-    OnlineManager online_manager;
+// 解析请求体中可选的 lat / lon 坐标，缺失或非法时返回空
+static std::optional<GeoPoint> parseLocation(const json& body) {
+    auto lat = body.find("lat");
+    auto lon = body.find("lon");
+    if (lat == body.end() || lon == body.end() || !lat->is_number() || !lon->is_number()) {
+        return std::nullopt;
+    }
+    GeoPoint point{lat->get<double>(), lon->get<double>()};
+    if (!point.valid()) return std::nullopt;
+    return point;
+}
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+// 在 httplib 创建的 SSL_CTX 上开启会话恢复和 kTLS
+static bool configureTls(SSL_CTX* ctx, const TlsConfig& config) {
+    // 会话恢复：TLS 1.3 / 1.2 无状态票据，同时保留服务端会话缓存兜底
+    static const unsigned char kSessionContext[] = "online-server";
+    SSL_CTX_set_session_id_context(ctx, kSessionContext, sizeof(kSessionContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, 1 << 16);
+    SSL_CTX_set_timeout(ctx, config.session_timeout_sec);
+    SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
     
-    httplib::Server server;
+    if (!config.ticket_key_file.empty()) {
+        unsigned char keys[80];
+        std::ifstream in(config.ticket_key_file, std::ios::binary);
+        if (!in.read(reinterpret_cast<char*>(keys), sizeof(keys)) ||
+            SSL_CTX_set_tlsext_ticket_keys(ctx, keys, sizeof(keys)) != 1) {
+            std::cerr << "invalid TLS ticket key file " << config.ticket_key_file
+                      << " (need 80 bytes)\n";
+            return false;
+        }
+    }
+    
+    // 大量空闲的心跳长连接不各自占着读写缓冲区
+    SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);
     
-    // 设置CORS头（如果前端是Web应用）
-    server.set_default_headers({
+    if (config.ktls) {
+#ifdef SSL_OP_ENABLE_KTLS
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#else
+        std::cerr << "kTLS unavailable: OpenSSL built without SSL_OP_ENABLE_KTLS\n";
+#endif
+    }
+    return true;
+}
+#endif
+
+// 设置CORS头（如果前端是Web应用），所有监听共用
+static httplib::Headers defaultHeaders() {
+    return {
         {"Access-Control-Allow-Origin", "*"},
         {"Access-Control-Allow-Methods", "GET, POST, OPTIONS"},
         {"Access-Control-Allow-Headers", "Content-Type"}
+    };
+}
+
+// 管理端接口的访问控制。返回的会话ID可直接用于心跳、退出和切换房间，而 CORS 放开了任意来源，
+// 所以这些接口不能对外公开：配置了 ONLINE_ADMIN_TOKEN 时要求 Authorization: Bearer <token>，
+// 未配置时只接受本机回环地址的请求。检查在路由层完成，HTTP/1.1、HTTPS 和 h2c 监听一致。
+static bool isLoopback(const std::string& addr) {
+    return addr.compare(0, 4, "127.") == 0 || addr == "::1" || addr.compare(0, 11, "::ffff:127.") == 0;
+}
+
+// 比较耗时与第一个不同字节的位置无关，避免按响应时间逐字节猜出令牌
+static bool tokenEquals(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+static Router::Handler adminOnly(const std::string& admin_token, Router::Handler handler) {
+    return [admin_token, handler = std::move(handler)](const httplib::Request& req, httplib::Response& res) {
+        bool allowed = admin_token.empty()
+            ? isLoopback(req.remote_addr)
+            : tokenEquals(req.get_header_value("Authorization"), "Bearer " + admin_token);
+        if (!allowed) {
+            res.status = admin_token.empty() ? 403 : 401;
+            json response = {{"code", -1}, {"message", "admin access denied"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        handler(req, res);
+    };
+}
+
+// HTTP/1.1 监听（明文和 TLS）的公共设置
+static void configureServer(httplib::Server& server) {
+    server.set_default_headers(defaultHeaders());
+    
+    // 网关通过连接池长连接访问，放宽 keep-alive 限制避免频繁重建连接
+    server.set_keep_alive_max_count(10000);
+    server.set_keep_alive_timeout(kSessionTimeoutSec);
+}
+
+// 登记全部路由，之后挂到各个监听上；admin_token 为空时管理端接口只接受本机请求
+static void registerRoutes(Router& router, OnlineManager& online_manager, const std::string& admin_token = "") {
+    // 所有路由统一计量 CPU：按路由计数，计量的请求再按 X-Tenant-Id 记到租户名下
+    router.use([](const std::string& method, const std::string& path, Router::Handler handler) {
+        size_t route = CpuAccounting::addRoute(method, path);
+        return Router::Handler([route, handler = std::move(handler)](const httplib::Request& req,
+                                                                     httplib::Response& res) {
+            std::string tenant = req.get_header_value("X-Tenant-Id");
+            if (tenant.empty()) tenant = "unknown";
+            auto sampling = CpuAccounting::countRequest(route, tenant);
+            if (sampling == CpuAccounting::Sampling::kNone) {
+                handler(req, res);
+                return;
+            }
+            uint64_t start = CpuAccounting::threadCpuNs();
+            handler(req, res);
+            CpuAccounting::recordSample(sampling, route, tenant, CpuAccounting::threadCpuNs() - start);
+        });
     });
     
     // 1. 获取在线人数
-    server.Get("/api/online/count", [&](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/online/count", [&](const httplib::Request& req, httplib::Response& res) {
         json response = {
             {"code", 0},
             {"message", "success"},
@@ -174,7 +924,7 @@ int main() {
     });
     
     // 2. 用户登录（上线）
-    server.Post("/api/online/login", [&](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/online/login", [&](const httplib::Request& req, httplib::Response& res) {
         try {
             auto body = json::parse(req.body);
             std::string user_id = body.value("user_id", "");
@@ -185,14 +935,18 @@ int main() {
                 return;
             }
             
-            std::string session_id = online_manager.userLogin(user_id);
+            ClientInfo client{req.remote_addr, body.value("platform", ""),
+                              body.value("app_version", "")};
+            std::string session_id = online_manager.userLogin(
+                user_id, parseLocation(body), body.value("room_id", ""), client);
             
             json response = {
                 {"code", 0},
                 {"message", "login success"},
                 {"data", {
                     {"session_id", session_id},
-                    {"online_count", online_manager.getOnlineCount()}
+                    {"online_count", online_manager.getOnlineCount()},
+                    {"heartbeat_interval", kHeartbeatIntervalSec}
                 }}
             };
             
@@ -207,7 +961,7 @@ int main() {
     });
     
     // 3. 心跳接口
-    server.Post("/api/online/heartbeat", [&](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/online/heartbeat", [&](const httplib::Request& req, httplib::Response& res) {
         try {
             auto body = json::parse(req.body);
             std::string session_id = body.value("session_id", "");
@@ -218,13 +972,45 @@ int main() {
                 return;
             }
             
-            bool success = online_manager.userHeartbeat(session_id);
+            bool success = online_manager.userHeartbeat(session_id, parseLocation(body));
             
             json response = {
                 {"code", success ? 0 : -1},
                 {"message", success ? "heartbeat success" : "invalid session"},
                 {"data", {
-                    {"online_count", online_manager.getOnlineCount()}
+                    {"online_count", online_manager.getOnlineCount()},
+                    {"heartbeat_interval", kHeartbeatIntervalSec}
+                }}
+            };
+            
+            res.set_content(response.dump(), "application/json");
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid request"}};
+            res.set_content(response.dump(), "application/json");
+        }
+    });
+    
+    // 3.1 批量心跳接口（网关合并多个会话的心跳）
+    router.Post("/api/online/heartbeat/batch", [&](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto body = json::parse(req.body);
+            auto session_ids = body.value("session_ids", std::vector<std::string>{});
+            
+            if (session_ids.empty()) {
+                json response = {{"code", -1}, {"message", "session_ids is required"}};
+                res.set_content(response.dump(), "application/json");
+                return;
+            }
+            
+            auto results = online_manager.userHeartbeatBatch(session_ids);
+            
+            json response = {
+                {"code", 0},
+                {"message", "heartbeat success"},
+                {"data", {
+                    {"results", results},
+                    {"online_count", online_manager.getOnlineCount()},
+                    {"heartbeat_interval", kHeartbeatIntervalSec}
                 }}
             };
             
@@ -236,7 +1022,7 @@ int main() {
     });
     
     // 4. 用户退出
-    server.Post("/api/online/logout", [&](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/online/logout", [&](const httplib::Request& req, httplib::Response& res) {
         try {
             auto body = json::parse(req.body);
             std::string session_id = body.value("session_id", "");
@@ -261,8 +1047,90 @@ int main() {
         }
     });
     
+    // 4.1 切换房间（一次请求完成离开旧房间和进入新房间）
+    router.Post("/api/online/room/move", [&](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto body = json::parse(req.body);
+            std::string session_id = body.value("session_id", "");
+            std::string room_id = body.value("room_id", "");
+            
+            if (session_id.empty()) {
+                json response = {{"code", -1}, {"message", "session_id is required"}};
+                res.set_content(response.dump(), "application/json");
+                return;
+            }
+            
+            auto move = online_manager.moveRoom(session_id, room_id);
+            if (!move.success) {
+                json response = {{"code", -1}, {"message", "invalid session"}};
+                res.set_content(response.dump(), "application/json");
+                return;
+            }
+            
+            json response = {
+                {"code", 0},
+                {"message", "move success"},
+                {"data", {
+                    {"from_room", move.from_room},
+                    {"from_count", move.from_count},
+                    {"room_id", room_id},
+                    {"room_count", move.to_count}
+                }}
+            };
+            
+            res.set_content(response.dump(), "application/json");
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid request"}};
+            res.set_content(response.dump(), "application/json");
+        }
+    });
+    
+    // 4.2 房间在线人数
+    router.Get("/api/online/room/count", [&](const httplib::Request& req, httplib::Response& res) {
+        std::string room_id = req.get_param_value("room_id");
+        if (room_id.empty()) {
+            json response = {{"code", -1}, {"message", "room_id is required"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", {
+                {"room_id", room_id},
+                {"online_count", online_manager.getRoomCount(room_id)}
+            }}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 4.3 房间在线用户列表
+    router.Get("/api/online/room/users", [&](const httplib::Request& req, httplib::Response& res) {
+        std::string room_id = req.get_param_value("room_id");
+        if (room_id.empty()) {
+            json response = {{"code", -1}, {"message", "room_id is required"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        auto users = online_manager.getRoomUsers(room_id);
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", {
+                {"room_id", room_id},
+                {"users", users},
+                {"count", users.size()}
+            }}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    });
+    
     // 5. 获取在线用户列表
-    server.Get("/api/online/users", [&](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/online/users", [&](const httplib::Request& req, httplib::Response& res) {
         auto users = online_manager.getOnlineUsers();
         
         json response = {
@@ -277,8 +1145,164 @@ int main() {
         res.set_content(response.dump(), "application/json");
     });
     
+    // 5.0 最近上线的用户
+    router.Get("/api/online/users/recent", [&](const httplib::Request& req, httplib::Response& res) {
+        size_t k = 20;
+        try {
+            if (req.has_param("k")) k = std::stoul(req.get_param_value("k"));
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid k"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        k = std::min<size_t>(k, 1000);
+        
+        json users = json::array();
+        for (const auto& item : online_manager.getRecentUsers(k)) {
+            users.push_back({{"user_id", item.user_id}, {"login_time", item.login_ms}});
+        }
+        
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", {
+                {"users", users},
+                {"count", users.size()}
+            }}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 5.1 最近 N 分钟活跃统计
+    router.Get("/api/online/active", [&](const httplib::Request& req, httplib::Response& res) {
+        json windows = json::array();
+        for (const auto& stats : online_manager.getActivityStats()) {
+            windows.push_back({
+                {"minutes", stats.minutes},
+                {"active_users", stats.active_users},
+                {"logins", stats.logins},
+                {"heartbeats", stats.heartbeats}
+            });
+        }
+        
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", {
+                {"online_count", online_manager.getOnlineCount()},
+                {"windows", windows}
+            }}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    // 5.2 查询用户最后在线时间
+    auto lastSeenJson = [](const std::string& user_id, const OnlineManager::LastSeen& seen) {
+        json item = {{"user_id", user_id}, {"online", seen.online}, {"last_seen", nullptr}};
+        if (seen.last_seen) {
+            item["last_seen"] = static_cast<int64_t>(*seen.last_seen) * 1000;
+        }
+        return item;
+    };
+    
+    router.Get("/api/online/lastseen", [&, lastSeenJson](const httplib::Request& req, httplib::Response& res) {
+        std::string user_id = req.get_param_value("user_id");
+        if (user_id.empty()) {
+            json response = {{"code", -1}, {"message", "user_id is required"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        auto seen = online_manager.getLastSeen({user_id});
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", lastSeenJson(user_id, seen[0])}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    });
+    
+    router.Post("/api/online/lastseen/batch", [&, lastSeenJson](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto body = json::parse(req.body);
+            auto user_ids = body.value("user_ids", std::vector<std::string>{});
+            
+            if (user_ids.empty()) {
+                json response = {{"code", -1}, {"message", "user_ids is required"}};
+                res.set_content(response.dump(), "application/json");
+                return;
+            }
+            
+            auto seen = online_manager.getLastSeen(user_ids);
+            json results = json::array();
+            for (size_t i = 0; i < user_ids.size(); ++i) {
+                results.push_back(lastSeenJson(user_ids[i], seen[i]));
+            }
+            
+            json response = {
+                {"code", 0},
+                {"message", "success"},
+                {"data", {{"results", results}}}
+            };
+            
+            res.set_content(response.dump(), "application/json");
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid request"}};
+            res.set_content(response.dump(), "application/json");
+        }
+    });
+    
+    // 5.3 附近在线用户
+    router.Get("/api/online/nearby", [&](const httplib::Request& req, httplib::Response& res) {
+        GeoPoint center;
+        double radius_m = 5000;
+        size_t k = 0;
+        size_t limit = 100;
+        try {
+            center.lat = std::stod(req.get_param_value("lat"));
+            center.lon = std::stod(req.get_param_value("lon"));
+            if (req.has_param("radius")) radius_m = std::stod(req.get_param_value("radius"));
+            if (req.has_param("k")) k = std::stoul(req.get_param_value("k"));
+            if (req.has_param("limit")) limit = std::stoul(req.get_param_value("limit"));
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "lat and lon are required"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        if (!center.valid() || !(radius_m > 0) || radius_m > 100000) {
+            json response = {{"code", -1}, {"message", "invalid coordinates or radius (max 100000m)"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        k = std::min<size_t>(k, 1000);
+        limit = std::min<size_t>(limit, 1000);
+        
+        json users = json::array();
+        for (const auto& hit : online_manager.getNearby(center, radius_m, k, limit)) {
+            users.push_back({
+                {"user_id", hit.user_id},
+                {"distance", std::round(hit.distance_m)}
+            });
+        }
+        
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", {
+                {"users", users},
+                {"count", users.size()}
+            }}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    });
+    
     // 6. 检查会话有效性
-    server.Post("/api/online/validate", [&](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/online/validate", [&](const httplib::Request& req, httplib::Response& res) {
         try {
             auto body = json::parse(req.body);
             std::string session_id = body.value("session_id", "");
@@ -306,8 +1330,176 @@ int main() {
         }
     });
     
+    // 6.1 批量检查会话有效性
+    router.Post("/api/online/validate/batch", [&](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto body = json::parse(req.body);
+            auto session_ids = body.value("session_ids", std::vector<std::string>{});
+            
+            if (session_ids.empty()) {
+                json response = {{"code", -1}, {"message", "session_ids is required"}};
+                res.set_content(response.dump(), "application/json");
+                return;
+            }
+            
+            json response = {
+                {"code", 0},
+                {"message", "success"},
+                {"data", {
+                    {"results", online_manager.validateBatch(session_ids)}
+                }}
+            };
+            
+            res.set_content(response.dump(), "application/json");
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid request"}};
+            res.set_content(response.dump(), "application/json");
+        }
+    });
+    
+    // 6.2 过滤出有效会话及其用户
+    router.Post("/api/online/sessions/filter", [&](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto body = json::parse(req.body);
+            auto session_ids = body.value("session_ids", std::vector<std::string>{});
+            
+            if (session_ids.empty()) {
+                json response = {{"code", -1}, {"message", "session_ids is required"}};
+                res.set_content(response.dump(), "application/json");
+                return;
+            }
+            
+            json sessions = json::array();
+            for (const auto& [session_id, user_id] : online_manager.filterSessions(session_ids)) {
+                sessions.push_back({{"session_id", session_id}, {"user_id", user_id}});
+            }
+            
+            json response = {
+                {"code", 0},
+                {"message", "success"},
+                {"data", {
+                    {"sessions", sessions},
+                    {"count", sessions.size()}
+                }}
+            };
+            
+            res.set_content(response.dump(), "application/json");
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid request"}};
+            res.set_content(response.dump(), "application/json");
+        }
+    });
+    
+    // 6.3 按登录元数据查询活跃会话（管理端）
+    // ?ip=10.0.0.0/8&platform=ios&version=1.2.3&min_version=1.2.0&since=<ms>&until=<ms>&limit=100
+    router.Get("/api/admin/sessions", adminOnly(admin_token, [&](const httplib::Request& req, httplib::Response& res) {
+        SessionMetaTable::Filter filter;
+        size_t limit = 100;
+        std::string error;
+        try {
+            if (req.has_param("ip") &&
+                !SessionMetaTable::parseCidr(req.get_param_value("ip"), filter.ip_net, filter.ip_mask)) {
+                error = "invalid ip range";
+            }
+            if (req.has_param("version")) {
+                filter.app_version = SessionMetaTable::parseVersion(req.get_param_value("version"));
+                if (*filter.app_version == 0) error = "invalid version";
+            }
+            if (req.has_param("min_version")) {
+                filter.min_version = SessionMetaTable::parseVersion(req.get_param_value("min_version"));
+                if (*filter.min_version == 0) error = "invalid min_version";
+            }
+            if (req.has_param("since")) filter.login_after_ms = std::stoll(req.get_param_value("since"));
+            if (req.has_param("until")) filter.login_before_ms = std::stoll(req.get_param_value("until"));
+            if (req.has_param("limit")) limit = std::stoul(req.get_param_value("limit"));
+        } catch (...) {
+            error = "invalid query parameters";
+        }
+        if (!error.empty()) {
+            json response = {{"code", -1}, {"message", error}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        limit = std::min<size_t>(limit, 1000);
+        
+        auto query = online_manager.querySessions(filter, req.get_param_value("platform"), limit);
+        json sessions = json::array();
+        for (const auto& session : query.sessions) {
+            sessions.push_back({
+                {"session_id", session.session_id},
+                {"user_id", session.user_id},
+                {"ip", session.ip},
+                {"platform", session.platform},
+                {"app_version", session.app_version},
+                {"login_time", session.login_ms}
+            });
+        }
+        
+        json response = {
+            {"code", 0},
+            {"message", "success"},
+            {"data", {
+                {"sessions", sessions},
+                {"count", sessions.size()},
+                {"total", query.total}
+            }}
+        };
+        
+        res.set_content(response.dump(), "application/json");
+    }));
+    
+    // 6.4 会话表列式导出（Arrow IPC 流），边拷贝边发送，不在内存中拼出完整数据
+    // ?compression=zstd|none&batch_rows=8192
+    router.Get("/api/admin/export", adminOnly(admin_token, [&](const httplib::Request& req, httplib::Response& res) {
+        std::string compression = req.has_param("compression") ? req.get_param_value("compression") : "zstd";
+        size_t batch_rows = 8192;
+        try {
+            if (req.has_param("batch_rows")) batch_rows = std::stoul(req.get_param_value("batch_rows"));
+        } catch (...) {
+            batch_rows = 0;
+        }
+        if ((compression != "zstd" && compression != "none") || batch_rows == 0) {
+            json response = {{"code", -1}, {"message", "invalid compression or batch_rows"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        batch_rows = std::min<size_t>(batch_rows, 65536);
+        
+        struct ExportState {
+            arrow_stream::StreamWriter writer;
+            arrow_stream::BatchBuilder batch;
+            uint32_t cursor = 0;
+            bool started = false;
+        };
+        auto state = std::make_shared<ExportState>(ExportState{
+            arrow_stream::StreamWriter(OnlineManager::exportSchema(),
+                                       compression == "zstd" ? arrow_stream::Compression::kZstd
+                                                             : arrow_stream::Compression::kNone),
+            arrow_stream::BatchBuilder(OnlineManager::exportSchema())});
+        
+        // 每次回调写出一条消息：先 Schema，再逐批 RecordBatch，最后结束标记
+        res.set_chunked_content_provider("application/vnd.apache.arrow.stream",
+            [&online_manager, state, batch_rows](size_t, httplib::DataSink& sink) {
+                CpuAccounting::Task task("export.arrow");
+                std::string message;
+                bool more = true;
+                if (!state->started) {
+                    state->started = true;
+                    message = state->writer.schema();
+                } else {
+                    state->batch.clear();
+                    more = online_manager.exportSessions(state->cursor, batch_rows, state->batch);
+                    if (state->batch.rows() > 0) message = state->writer.batch(state->batch);
+                    if (!more) message += arrow_stream::StreamWriter::endOfStream();
+                }
+                if (!message.empty() && !sink.write(message.data(), message.size())) return false;
+                if (!more) sink.done();
+                return true;
+            });
+    }));
+    
     // 7. 健康检查
-    server.Get("/api/health", [](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/health", [](const httplib::Request& req, httplib::Response& res) {
         json response = {
             {"status", "healthy"},
             {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -316,8 +1508,38 @@ int main() {
         res.set_content(response.dump(), "application/json");
     });
     
-    // 8. 首页
-    server.Get("/", [](const httplib::Request& req, httplib::Response& res) {
+    // 7.1 运行指标（Prometheus 文本格式）：按路由、租户、后台任务的 CPU 时间
+    router.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(CpuAccounting::prometheus(), "text/plain; version=0.0.4");
+    });
+    
+    // 8. CPU 采样分析，返回 folded stacks，可直接生成火焰图
+    router.Get("/debug/profile", [](const httplib::Request& req, httplib::Response& res) {
+        int seconds = 10;
+        int hz = 99;
+        try {
+            if (req.has_param("seconds")) seconds = std::stoi(req.get_param_value("seconds"));
+            if (req.has_param("hz")) hz = std::stoi(req.get_param_value("hz"));
+        } catch (...) {
+            json response = {{"code", -1}, {"message", "invalid seconds or hz"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        CpuProfiler::Result result;
+        if (!CpuProfiler::profile(seconds, hz, result)) {
+            json response = {{"code", -1}, {"message", "profiler busy or unavailable"}};
+            res.set_content(response.dump(), "application/json");
+            return;
+        }
+        
+        res.set_header("X-Profile-Samples", std::to_string(result.samples));
+        res.set_header("X-Profile-Dropped", std::to_string(result.dropped));
+        res.set_content(result.folded, "text/plain");
+    });
+    
+    // 9. 首页
+    router.Get("/", [](const httplib::Request& req, httplib::Response& res) {
         std::string html = R"(
 <!DOCTYPE html>
 <html>
@@ -344,15 +1566,60 @@ int main() {
     <div class="endpoint">
         <span class="method">POST</span> <span class="path">/api/online/heartbeat</span> - 心跳
     </div>
+    <div class="endpoint">
+        <span class="method">POST</span> <span class="path">/api/online/heartbeat/batch</span> - 批量心跳
+    </div>
     <div class="endpoint">
         <span class="method">POST</span> <span class="path">/api/online/logout</span> - 用户退出
     </div>
+    <div class="endpoint">
+        <span class="method">POST</span> <span class="path">/api/online/room/move</span> - 切换房间
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/online/room/count?room_id=</span> - 房间在线人数
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/online/room/users?room_id=</span> - 房间在线用户列表
+    </div>
     <div class="endpoint">
         <span class="method">GET</span> <span class="path">/api/online/users</span> - 获取在线用户列表
     </div>
+    <div class="endpoint">
+        <span class="method">POST</span> <span class="path">/api/online/validate/batch</span> - 批量检查会话有效性
+    </div>
+    <div class="endpoint">
+        <span class="method">POST</span> <span class="path">/api/online/sessions/filter</span> - 过滤有效会话
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/online/users/recent?k=</span> - 最近上线的用户
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/online/active</span> - 最近 5/15/60 分钟活跃统计
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/online/lastseen?user_id=</span> - 用户最后在线时间
+    </div>
+    <div class="endpoint">
+        <span class="method">POST</span> <span class="path">/api/online/lastseen/batch</span> - 批量查询最后在线时间
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/online/nearby?lat=&amp;lon=&amp;radius=&amp;k=</span> - 附近在线用户
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/admin/sessions?ip=&amp;platform=&amp;version=</span> - 按登录元数据查询会话（需管理令牌）
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/api/admin/export?compression=zstd</span> - 会话表列式导出（Arrow IPC 流，需管理令牌）
+    </div>
     <div class="endpoint">
         <span class="method">GET</span> <span class="path">/api/health</span> - 健康检查
     </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/metrics</span> - 按路由 / 租户 / 后台任务的 CPU 时间（Prometheus）
+    </div>
+    <div class="endpoint">
+        <span class="method">GET</span> <span class="path">/debug/profile?seconds=N&amp;hz=M</span> - CPU 采样（folded stacks）
+    </div>
     
     <p>当前时间: <span id="time"></span></p>
     <p>当前在线人数: <span id="count">0</span></p>
@@ -383,19 +1650,133 @@ int main() {
         )";
         res.set_content(html, "text/html");
     });
+}
+
+// bench/perf_gate.cpp 直接包含本文件以复用 OnlineManager 和路由，编译时定义 ONLINE_SERVER_NO_MAIN 跳过 main
+#ifndef ONLINE_SERVER_NO_MAIN
+int main() {
+    // 屏蔽 SIGINT/SIGTERM，由专门的线程 sigwait 后停止服务，使析构函数能保存会话
+    // 必须在创建任何线程之前设置，新线程会继承信号屏蔽字
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+    
+    OnlineManager online_manager(OnlineConfig::fromEnv());
+    TlsConfig tls_config = TlsConfig::fromEnv();
+    
+    // 每个线程每 N 个请求抽样测一次 CPU 时间，0 表示只计请求数
+    CpuAccounting::setSampleInterval(static_cast<uint32_t>(
+        std::max(0L, envLong("ONLINE_CPU_SAMPLE_EVERY", CpuAccounting::sampleInterval()))));
+    // 每个租户在每个线程、每个抓取周期内的前 M 个请求完整计量，请求少的租户也有准确的 CPU 时间
+    CpuAccounting::setTenantFirstRequests(static_cast<uint32_t>(
+        std::max(0L, envLong("ONLINE_CPU_TENANT_FIRST", CpuAccounting::tenantFirstRequests()))));
+    
+    Router router;
+    registerRoutes(router, online_manager, envString("ONLINE_ADMIN_TOKEN"));
+    
+    httplib::Server server;
+    configureServer(server);
+    router.mount(server);
+    
+    // HTTPS 监听与明文监听共用同一套路由，在单独的线程里运行
+    std::unique_ptr<httplib::Server> tls_server;
+    if (tls_config.enabled()) {
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+        auto ssl_server = std::make_unique<httplib::SSLServer>(tls_config.cert_file.c_str(),
+                                                               tls_config.key_file.c_str());
+        if (!ssl_server->is_valid() || !configureTls(ssl_server->ssl_context(), tls_config)) {
+            std::cerr << "cannot load TLS certificate " << tls_config.cert_file << "\n";
+            return 1;
+        }
+        configureServer(*ssl_server);
+        router.mount(*ssl_server);
+        tls_server = std::move(ssl_server);
+#else
+        std::cerr << "TLS disabled: server was built without CPPHTTPLIB_OPENSSL_SUPPORT\n";
+#endif
+    }
+    
+    // h2c（HTTP/2 明文）监听，网关在一条连接上多路复用心跳；端口为 0 时不启用
+    int h2c_port = static_cast<int>(envLong("ONLINE_H2C_PORT", 8081));
+    H2cServer::Options h2c_options;
+    h2c_options.default_headers = defaultHeaders();
+    H2cServer h2c_server([&router](const httplib::Request& req, httplib::Response& res) {
+        return router.dispatch(req, res);
+    }, h2c_options);
     
     std::cout << "Starting server on port 8080...\n";
     std::cout << "API endpoints:\n";
     std::cout << "  GET  /api/online/count     - 获取在线人数\n";
     std::cout << "  GET  /api/online/users     - 获取在线用户列表\n";
+    std::cout << "  GET  /api/online/users/recent - 最近上线的用户（?k=）\n";
+    std::cout << "  GET  /api/online/active    - 最近 5/15/60 分钟活跃统计\n";
+    std::cout << "  GET  /api/online/nearby    - 附近在线用户（?lat=&lon=&radius=&k=）\n";
     std::cout << "  POST /api/online/login     - 用户登录\n";
     std::cout << "  POST /api/online/heartbeat - 心跳\n";
+    std::cout << "  POST /api/online/heartbeat/batch - 批量心跳\n";
     std::cout << "  POST /api/online/logout    - 用户退出\n";
     std::cout << "  POST /api/online/validate  - 检查会话有效性\n";
+    std::cout << "  POST /api/online/validate/batch - 批量检查会话有效性\n";
+    std::cout << "  POST /api/online/sessions/filter - 过滤有效会话\n";
+    std::cout << "  POST /api/online/room/move - 切换房间\n";
+    std::cout << "  GET  /api/online/room/count - 房间在线人数\n";
+    std::cout << "  GET  /api/online/room/users - 房间在线用户列表\n";
+    std::cout << "  GET  /api/online/lastseen  - 用户最后在线时间\n";
+    std::cout << "  POST /api/online/lastseen/batch - 批量查询最后在线时间\n";
+    std::cout << "  GET  /api/admin/sessions   - 按登录元数据查询会话（?ip=&platform=&version=，需管理令牌）\n";
+    std::cout << "  GET  /api/admin/export     - 会话表列式导出（Arrow IPC 流，?compression=zstd|none，需管理令牌）\n";
     std::cout << "  GET  /api/health           - 健康检查\n";
+    std::cout << "  GET  /metrics              - 按路由 / 租户 / 后台任务的 CPU 时间（Prometheus，租户取 X-Tenant-Id）\n";
+    std::cout << "  GET  /debug/profile        - CPU 采样（?seconds=N&hz=M）\n";
     std::cout << "  GET  /                      - 首页\n";
+    std::cout << "管理端接口需 Authorization: Bearer $ONLINE_ADMIN_TOKEN，未设置令牌时只接受本机请求\n";
+    std::cout << "h2c 监听（ONLINE_H2C_PORT，默认 8081，HTTP/2 prior knowledge）提供同一组接口，/api/admin/export 除外\n";
+    
+    std::thread signal_thread([&server, &tls_server, &h2c_server, stop_signals]() {
+        int sig = 0;
+        sigwait(&stop_signals, &sig);
+        server.stop();
+        if (tls_server) tls_server->stop();
+        h2c_server.stop();
+    });
+    
+    std::thread tls_thread;
+    if (tls_server) {
+        std::cout << "Starting TLS server on port " << tls_config.port << "...\n";
+        tls_thread = std::thread([&tls_server, &tls_config]() {
+            if (!tls_server->listen("0.0.0.0", tls_config.port)) {
+                std::cerr << "TLS listener on port " << tls_config.port << " failed\n";
+            }
+        });
+    }
+    
+    std::thread h2c_thread;
+    if (h2c_port > 0) {
+        std::cout << "Starting h2c server on port " << h2c_port << "...\n";
+        h2c_thread = std::thread([&h2c_server, h2c_port]() {
+            if (!h2c_server.listen("0.0.0.0", h2c_port)) {
+                std::cerr << "h2c listener on port " << h2c_port << " failed\n";
+            }
+        });
+    }
     
     server.listen("0.0.0.0", 8080);
     
+    // listen 返回（收到信号或监听失败）后停止其它监听，唤醒并回收信号线程
+    if (tls_server) {
+        tls_server->stop();
+        tls_thread.join();
+    }
+    if (h2c_thread.joinable()) {
+        h2c_server.stop();
+        h2c_thread.join();
+    }
+    pthread_kill(signal_thread.native_handle(), SIGTERM);
+    signal_thread.join();
+    std::cout << "Server stopped\n";
+    
     return 0;
 }
+#endif  // ONLINE_SERVER_NO_MAIN
@@ -0,0 +1,185 @@
+// session_index.h - 会话ID到会话槽的开放寻址哈希索引
+//
+// 桶只存 64 位哈希和槽号（16 字节，一条缓存行 4 个桶），键本身留在会话槽里，
+// 通过 KeyOf(slot) 取得。线性探测，删除时向后移位，不留墓碑。
+//
+// findBatch() 按组流水线执行批量查找（group prefetching）：
+//   1. 先算出整组键的哈希，预取各自的桶
+//   2. 读桶找到哈希匹配的槽，预取会话槽
+//   3. 读会话槽里的键指针，预取键的字符数据
+//   4. 比较键，确认命中
+// 每一步都只访问上一步已经预取的内存，组内的 DRAM 访问得以重叠，
+// 表远大于末级缓存时比逐个查找快得多。非线程安全，由调用方加锁。
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+template <typename KeyOf>
+class SessionIndex {
+public:
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+    static constexpr size_t kGroupSize = 16;   // 每组同时在途的查找数
+
+    explicit SessionIndex(KeyOf key_of, size_t initial_capacity = 1024)
+        : key_of_(key_of) {
+        size_t capacity = 16;
+        while (capacity < initial_capacity * 2) capacity <<= 1;
+        buckets_.assign(capacity, Bucket{0, kEmpty, 0});
+        mask_ = capacity - 1;
+    }
+
+    static uint64_t hashOf(const std::string& key) {
+        uint64_t x = std::hash<std::string>{}(key);
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // 批量计算哈希，不访问表，可以在加锁前完成
+    static void hashBatch(const std::string* keys, size_t n, uint64_t* hashes) {
+        for (size_t i = 0; i < n; ++i) hashes[i] = hashOf(keys[i]);
+    }
+
+    size_t size() const { return size_; }
+
+    uint32_t find(const std::string& key) const {
+        uint64_t hash = hashOf(key);
+        return probe(key, hash, hash & mask_);
+    }
+
+    // 插入新键，调用方保证键不存在
+    void insert(const std::string& key, uint32_t slot) {
+        if ((size_ + 1) * 2 > buckets_.size()) {
+            rehash(buckets_.size() * 2);
+        }
+        uint64_t hash = hashOf(key);
+        size_t pos = hash & mask_;
+        while (buckets_[pos].slot != kEmpty) {
+            pos = (pos + 1) & mask_;
+        }
+        buckets_[pos] = {hash, slot, 0};
+        ++size_;
+    }
+
+    bool erase(const std::string& key) {
+        uint64_t hash = hashOf(key);
+        size_t pos = hash & mask_;
+        while (true) {
+            const Bucket& b = buckets_[pos];
+            if (b.slot == kEmpty) return false;
+            if (b.hash == hash && key_of_(b.slot) == key) break;
+            pos = (pos + 1) & mask_;
+        }
+
+        // 向后移位删除：把后续仍能落到空洞处的条目前移，保持探测链连续
+        size_t hole = pos;
+        size_t next = (pos + 1) & mask_;
+        while (buckets_[next].slot != kEmpty) {
+            size_t ideal = buckets_[next].hash & mask_;
+            if (((next - ideal) & mask_) >= ((next - hole) & mask_)) {
+                buckets_[hole] = buckets_[next];
+                hole = next;
+            }
+            next = (next + 1) & mask_;
+        }
+        buckets_[hole].slot = kEmpty;
+        --size_;
+        return true;
+    }
+
+    // 批量查找，hashes 由 hashBatch 预先算好；out[i] 为槽号或 kNotFound
+    void findBatch(const std::string* keys, const uint64_t* hashes, size_t n, uint32_t* out) const {
+        size_t pos[kGroupSize];
+        uint32_t candidate[kGroupSize];
+
+        for (size_t base = 0; base < n; base += kGroupSize) {
+            size_t m = std::min(kGroupSize, n - base);
+
+            // 1. 预取桶
+            for (size_t i = 0; i < m; ++i) {
+                pos[i] = hashes[base + i] & mask_;
+                __builtin_prefetch(&buckets_[pos[i]]);
+            }
+
+            // 2. 找哈希匹配的桶，预取会话槽
+            for (size_t i = 0; i < m; ++i) {
+                candidate[i] = kNotFound;
+                size_t p = pos[i];
+                while (buckets_[p].slot != kEmpty) {
+                    if (buckets_[p].hash == hashes[base + i]) {
+                        candidate[i] = buckets_[p].slot;
+                        __builtin_prefetch(&key_of_(candidate[i]));
+                        break;
+                    }
+                    p = (p + 1) & mask_;
+                }
+                pos[i] = p;
+            }
+
+            // 3. 预取键的字符数据
+            for (size_t i = 0; i < m; ++i) {
+                if (candidate[i] != kNotFound) {
+                    __builtin_prefetch(key_of_(candidate[i]).data());
+                }
+            }
+
+            // 4. 比较键；64 位哈希碰撞极少，碰撞时从下一个桶继续逐个探测
+            for (size_t i = 0; i < m; ++i) {
+                const std::string& key = keys[base + i];
+                if (candidate[i] == kNotFound) {
+                    out[base + i] = kNotFound;
+                } else if (key_of_(candidate[i]) == key) {
+                    out[base + i] = candidate[i];
+                } else {
+                    out[base + i] = probe(key, hashes[base + i], (pos[i] + 1) & mask_);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    struct Bucket {
+        uint64_t hash;
+        uint32_t slot;      // kEmpty 表示空桶
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Bucket) == 16, "four buckets per cache line");
+
+    uint32_t probe(const std::string& key, uint64_t hash, size_t pos) const {
+        while (true) {
+            const Bucket& b = buckets_[pos];
+            if (b.slot == kEmpty) return kNotFound;
+            if (b.hash == hash && key_of_(b.slot) == key) return b.slot;
+            pos = (pos + 1) & mask_;
+        }
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Bucket> old;
+        old.swap(buckets_);
+        buckets_.assign(capacity, Bucket{0, kEmpty, 0});
+        mask_ = capacity - 1;
+        for (const Bucket& b : old) {
+            if (b.slot == kEmpty) continue;
+            size_t pos = b.hash & mask_;
+            while (buckets_[pos].slot != kEmpty) {
+                pos = (pos + 1) & mask_;
+            }
+            buckets_[pos] = b;
+        }
+    }
+
+    KeyOf key_of_;
+    std::vector<Bucket> buckets_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
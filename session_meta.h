@@ -0,0 +1,231 @@
+// session_meta.h - 会话元数据列式旁路表
+//
+// 登录时间、客户端 IP、平台、客户端版本按列存放，下标即会话槽号，
+// 心跳路径完全不碰这些数据。管理端按条件扫描时每个条件单独过一遍对应的列，
+// 产出逐字节的匹配掩码：循环体无分支、访问连续，编译器可以自动向量化。
+// 非线程安全，由调用方加锁。
+#pragma once
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 单个会话的元数据（已编码），挂起会话也用它暂存
+struct SessionMeta {
+    int64_t login_ms = 0;       // 登录时间（Unix 毫秒）
+    uint32_t ipv4 = 0;          // 主机字节序，0 表示未知或 IPv6
+    uint32_t app_version = 0;   // major << 24 | minor << 12 | patch，0 表示未知
+    uint8_t platform = 0;       // 平台字典编码，0 表示未知
+};
+
+class SessionMetaTable {
+public:
+    // 扫描条件，未设置的字段不参与过滤
+    struct Filter {
+        uint32_t ip_net = 0;
+        uint32_t ip_mask = 0;                  // 0 表示不过滤 IP
+        std::optional<uint8_t> platform;
+        std::optional<uint32_t> app_version;   // 精确匹配
+        std::optional<uint32_t> min_version;   // 大于等于
+        int64_t login_after_ms = INT64_MIN;
+        int64_t login_before_ms = INT64_MAX;
+    };
+
+    static constexpr uint8_t kOtherPlatform = 1;   // 字典写满后新平台统一归入 "other"
+
+    SessionMetaTable() {
+        platform_names_.push_back("");
+        platform_names_.push_back("other");
+        platform_codes_.emplace("other", kOtherPlatform);
+    }
+
+    void set(uint32_t slot, const SessionMeta& meta) {
+        if (slot >= live_.size()) grow(slot + 1);
+        login_hi_[slot] = static_cast<int32_t>(meta.login_ms >> 32);
+        login_lo_[slot] = static_cast<uint32_t>(meta.login_ms);
+        ipv4_[slot] = meta.ipv4;
+        app_version_[slot] = meta.app_version;
+        platform_[slot] = meta.platform;
+        live_[slot] = 1;
+    }
+
+    void clear(uint32_t slot) {
+        if (slot < live_.size()) live_[slot] = 0;
+    }
+
+    SessionMeta get(uint32_t slot) const {
+        int64_t login_ms = static_cast<int64_t>(static_cast<uint64_t>(login_hi_[slot]) << 32 | login_lo_[slot]);
+        return {login_ms, ipv4_[slot], app_version_[slot], platform_[slot]};
+    }
+
+    // 按条件扫描，返回匹配的槽号（最多 limit 个）和匹配总数
+    size_t scan(const Filter& filter, size_t limit, std::vector<uint32_t>& slots) const {
+        uint8_t mask[kBlock];
+        size_t total = 0;
+        size_t n = live_.size();
+
+        // 列容量总是 kBlock 的整数倍，内层循环次数固定，-O2 下也能向量化
+        for (size_t base = 0; base < n; base += kBlock) {
+            constexpr size_t m = kBlock;
+            const uint8_t* live = &live_[base];
+            for (size_t i = 0; i < m; ++i) mask[i] = live[i];
+
+            if (filter.ip_mask != 0) {
+                const uint32_t* ip = &ipv4_[base];
+                for (size_t i = 0; i < m; ++i) {
+                    mask[i] &= static_cast<uint8_t>((ip[i] & filter.ip_mask) == filter.ip_net);
+                }
+            }
+            if (filter.platform) {
+                const uint8_t* platform = &platform_[base];
+                uint8_t want = *filter.platform;
+                for (size_t i = 0; i < m; ++i) {
+                    mask[i] &= static_cast<uint8_t>(platform[i] == want);
+                }
+            }
+            if (filter.app_version) {
+                const uint32_t* version = &app_version_[base];
+                uint32_t want = *filter.app_version;
+                for (size_t i = 0; i < m; ++i) {
+                    mask[i] &= static_cast<uint8_t>(version[i] == want);
+                }
+            }
+            if (filter.min_version) {
+                const uint32_t* version = &app_version_[base];
+                uint32_t min = *filter.min_version;
+                for (size_t i = 0; i < m; ++i) {
+                    mask[i] &= static_cast<uint8_t>(version[i] >= min);
+                }
+            }
+            // 64 位比较在基线 x86-64（SSE2）上没有向量指令，登录时间拆成高低两个 32 位列按字典序比较
+            if (filter.login_after_ms != INT64_MIN) {
+                const int32_t* hi = &login_hi_[base];
+                const uint32_t* lo = &login_lo_[base];
+                int32_t want_hi = static_cast<int32_t>(filter.login_after_ms >> 32);
+                uint32_t want_lo = static_cast<uint32_t>(filter.login_after_ms);
+                for (size_t i = 0; i < m; ++i) {
+                    mask[i] &= static_cast<uint8_t>((hi[i] > want_hi) | ((hi[i] == want_hi) & (lo[i] >= want_lo)));
+                }
+            }
+            if (filter.login_before_ms != INT64_MAX) {
+                const int32_t* hi = &login_hi_[base];
+                const uint32_t* lo = &login_lo_[base];
+                int32_t want_hi = static_cast<int32_t>(filter.login_before_ms >> 32);
+                uint32_t want_lo = static_cast<uint32_t>(filter.login_before_ms);
+                for (size_t i = 0; i < m; ++i) {
+                    mask[i] &= static_cast<uint8_t>((hi[i] < want_hi) | ((hi[i] == want_hi) & (lo[i] < want_lo)));
+                }
+            }
+
+            for (size_t i = 0; i < m; ++i) {
+                if (mask[i]) {
+                    if (slots.size() < limit) slots.push_back(static_cast<uint32_t>(base + i));
+                    ++total;
+                }
+            }
+        }
+        return total;
+    }
+
+    // 平台名字典编码，超过 255 种后统一编码为 "other"
+    uint8_t platformCode(const std::string& name) {
+        if (name.empty()) return 0;
+        auto it = platform_codes_.find(name);
+        if (it != platform_codes_.end()) return it->second;
+        if (platform_names_.size() >= 255) return kOtherPlatform;
+        uint8_t code = static_cast<uint8_t>(platform_names_.size());
+        platform_names_.push_back(name);
+        platform_codes_.emplace(name, code);
+        return code;
+    }
+
+    // 只查询不新增，未知平台返回空
+    std::optional<uint8_t> findPlatform(const std::string& name) const {
+        auto it = platform_codes_.find(name);
+        if (it == platform_codes_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    const std::string& platformName(uint8_t code) const {
+        return code < platform_names_.size() ? platform_names_[code] : platform_names_[0];
+    }
+
+    // "1.2.3" -> major << 24 | minor << 12 | patch；格式不对返回 0
+    static uint32_t parseVersion(const std::string& text) {
+        unsigned major = 0, minor = 0, patch = 0;
+        int fields = std::sscanf(text.c_str(), "%u.%u.%u", &major, &minor, &patch);
+        if (fields < 1 || major > 255 || minor > 4095 || patch > 4095) return 0;
+        return (major << 24) | (minor << 12) | patch;
+    }
+
+    static std::string formatVersion(uint32_t version) {
+        if (version == 0) return "";
+        return std::to_string(version >> 24) + "." + std::to_string((version >> 12) & 0xfff) +
+               "." + std::to_string(version & 0xfff);
+    }
+
+    // IPv4 点分十进制转主机字节序整数，非 IPv4 返回 0
+    static uint32_t parseIpv4(std::string text) {
+        if (text.compare(0, 7, "::ffff:") == 0) text.erase(0, 7);  // IPv4 映射的 IPv6 地址
+        in_addr addr{};
+        if (inet_pton(AF_INET, text.c_str(), &addr) != 1) return 0;
+        return ntohl(addr.s_addr);
+    }
+
+    static std::string formatIpv4(uint32_t ip) {
+        if (ip == 0) return "";
+        in_addr addr{};
+        addr.s_addr = htonl(ip);
+        char buf[INET_ADDRSTRLEN];
+        return inet_ntop(AF_INET, &addr, buf, sizeof(buf)) ? buf : "";
+    }
+
+    // 解析 "10.0.0.0/8" 或单个 IP，失败返回 false
+    static bool parseCidr(const std::string& text, uint32_t& net, uint32_t& mask) {
+        auto slash = text.find('/');
+        uint32_t ip = parseIpv4(text.substr(0, slash));
+        if (ip == 0) return false;
+        int bits = 32;
+        if (slash != std::string::npos) {
+            try {
+                bits = std::stoi(text.substr(slash + 1));
+            } catch (...) {
+                return false;
+            }
+            if (bits < 1 || bits > 32) return false;
+        }
+        mask = bits == 32 ? 0xffffffffu : ~((1u << (32 - bits)) - 1);
+        net = ip & mask;
+        return true;
+    }
+
+private:
+    static constexpr size_t kBlock = 1024;   // 扫描分块大小
+
+    void grow(size_t size) {
+        size_t capacity = std::max<size_t>(size, live_.size() * 2);
+        capacity = (capacity + kBlock - 1) / kBlock * kBlock;
+        login_hi_.resize(capacity, 0);
+        login_lo_.resize(capacity, 0);
+        ipv4_.resize(capacity, 0);
+        app_version_.resize(capacity, 0);
+        platform_.resize(capacity, 0);
+        live_.resize(capacity, 0);
+    }
+
+    std::vector<int32_t> login_hi_;    // 登录毫秒的高 32 位（有符号）
+    std::vector<uint32_t> login_lo_;   // 登录毫秒的低 32 位
+    std::vector<uint32_t> ipv4_;
+    std::vector<uint32_t> app_version_;
+    std::vector<uint8_t> platform_;
+    std::vector<uint8_t> live_;
+
+    std::vector<std::string> platform_names_;
+    std::unordered_map<std::string, uint8_t> platform_codes_;
+};
@@ -0,0 +1,225 @@
+// spatial_index.h - 在线会话空间索引
+//
+// 经纬度按固定角度切成网格，每个格子保存落在其中的会话；
+// 半径查询只扫描与查询圆外接矩形相交的格子，矩形比有人的格子还多时改为遍历有人的格子，
+// k 近邻通过逐步扩大半径实现。
+// 会话移动或下线时 O(1) 从格子中移除（交换删除）。非线程安全，由调用方加锁。
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct GeoPoint {
+    double lat = 0.0;
+    double lon = 0.0;
+
+    bool valid() const {
+        return std::isfinite(lat) && std::isfinite(lon) &&
+               lat >= -90.0 && lat <= 90.0 && lon >= -180.0 && lon <= 180.0;
+    }
+};
+
+class SpatialIndex {
+public:
+    struct Hit {
+        std::string user_id;
+        std::string session_id;
+        double distance_m = 0.0;
+    };
+
+    explicit SpatialIndex(double cell_deg = 0.01)
+        : cell_deg_(cell_deg),
+          lon_cells_(static_cast<int64_t>(std::ceil(360.0 / cell_deg))) {}
+
+    // 插入或移动会话位置
+    void update(const std::string& session_id, const std::string& user_id, const GeoPoint& point) {
+        uint64_t cell = cellOf(latIndex(point.lat), lonIndex(point.lon));
+        auto it = locations_.find(session_id);
+        if (it != locations_.end()) {
+            if (it->second.cell == cell) {
+                Entry& entry = cells_[cell][it->second.index];
+                entry.point = point;
+                return;
+            }
+            detach(it->second);
+        } else {
+            it = locations_.emplace(session_id, Location{}).first;
+        }
+
+        auto& bucket = cells_[cell];
+        it->second.cell = cell;
+        it->second.index = bucket.size();
+        bucket.push_back({&it->first, user_id, point});
+    }
+
+    void remove(const std::string& session_id) {
+        auto it = locations_.find(session_id);
+        if (it == locations_.end()) return;
+        detach(it->second);
+        locations_.erase(it);
+    }
+
+    // 会话当前登记的位置，未上报过坐标时返回空
+    std::optional<GeoPoint> location(const std::string& session_id) const {
+        auto it = locations_.find(session_id);
+        if (it == locations_.end()) return std::nullopt;
+        return cells_.at(it->second.cell)[it->second.index].point;
+    }
+
+    size_t size() const { return locations_.size(); }
+
+    // 半径查询，结果按距离升序，同一用户多个会话只保留最近的一个
+    std::vector<Hit> withinRadius(const GeoPoint& center, double radius_m, size_t limit) const {
+        std::vector<Hit> hits;
+        std::unordered_map<std::string, size_t> by_user;
+        auto collect = [&](const std::vector<Entry>& bucket) {
+            for (const Entry& entry : bucket) {
+                double d = distanceMeters(center, entry.point);
+                if (d > radius_m) continue;
+                auto seen = by_user.find(entry.user_id);
+                if (seen != by_user.end()) {
+                    if (d < hits[seen->second].distance_m) {
+                        hits[seen->second] = {entry.user_id, *entry.session_id, d};
+                    }
+                    continue;
+                }
+                by_user.emplace(entry.user_id, hits.size());
+                hits.push_back({entry.user_id, *entry.session_id, d});
+            }
+        };
+
+        Box box = boundingBox(center, radius_m);
+        if (box.cells() > cells_.size()) {
+            // 矩形内的格子比有人的格子还多（大半径、靠近极点时整圈都在矩形内），
+            // 改为遍历有人的格子，查询代价不超过 O(在线会话数)
+            for (const auto& cell : cells_) {
+                if (box.contains(cell.first, lon_cells_)) collect(cell.second);
+            }
+        } else {
+            for (int64_t la = box.lat_lo; la <= box.lat_hi; ++la) {
+                for (int64_t lo = box.lon_lo; lo <= box.lon_hi; ++lo) {
+                    // 经度在 ±180 处回绕
+                    int64_t wrapped = ((lo % lon_cells_) + lon_cells_) % lon_cells_;
+                    auto cell = cells_.find(cellOf(la, wrapped));
+                    if (cell != cells_.end()) collect(cell->second);
+                }
+            }
+        }
+
+        std::sort(hits.begin(), hits.end(),
+                  [](const Hit& a, const Hit& b) { return a.distance_m < b.distance_m; });
+        if (hits.size() > limit) hits.resize(limit);
+        return hits;
+    }
+
+    // k 近邻：从一个格子大小开始倍增半径，直到凑够 k 个或超过 max_radius_m；
+    // 矩形一旦大到要遍历全部有人的格子，再倍增也不会更便宜，直接按 max_radius_m 查最后一次
+    std::vector<Hit> nearest(const GeoPoint& center, size_t k, double max_radius_m) const {
+        double radius = std::min(max_radius_m, cell_deg_ * kMetersPerDegree);
+        while (true) {
+            if (boundingBox(center, radius).cells() > cells_.size()) radius = max_radius_m;
+            auto hits = withinRadius(center, radius, k);
+            if (hits.size() >= k || radius >= max_radius_m) return hits;
+            radius = std::min(max_radius_m, radius * 2);
+        }
+    }
+
+    static double distanceMeters(const GeoPoint& a, const GeoPoint& b) {
+        constexpr double kRad = M_PI / 180.0;
+        double dlat = (b.lat - a.lat) * kRad;
+        double dlon = (b.lon - a.lon) * kRad;
+        double h = std::sin(dlat / 2) * std::sin(dlat / 2) +
+                   std::cos(a.lat * kRad) * std::cos(b.lat * kRad) *
+                   std::sin(dlon / 2) * std::sin(dlon / 2);
+        return 2 * kEarthRadiusM * std::asin(std::min(1.0, std::sqrt(h)));
+    }
+
+private:
+    static constexpr double kEarthRadiusM = 6371008.8;
+    static constexpr double kMetersPerDegree = kEarthRadiusM * M_PI / 180.0;
+
+    struct Entry {
+        const std::string* session_id;  // 指向 locations_ 的键，unordered_map 节点地址稳定
+        std::string user_id;
+        GeoPoint point;
+    };
+
+    struct Location {
+        uint64_t cell = 0;
+        size_t index = 0;
+    };
+
+    // 查询圆的外接矩形（格子下标），经度下标可能越过 [0, lon_cells) 需要回绕
+    struct Box {
+        int64_t lat_lo = 0;
+        int64_t lat_hi = 0;
+        int64_t lon_lo = 0;
+        int64_t lon_hi = 0;
+
+        size_t cells() const {
+            return static_cast<size_t>(lat_hi - lat_lo + 1) * static_cast<size_t>(lon_hi - lon_lo + 1);
+        }
+
+        bool contains(uint64_t cell, int64_t lon_cells) const {
+            int64_t la = static_cast<int64_t>(cell >> 32);
+            int64_t lo = static_cast<int64_t>(static_cast<uint32_t>(cell));
+            if (la < lat_lo || la > lat_hi) return false;
+            return ((lo - lon_lo) % lon_cells + lon_cells) % lon_cells <= lon_hi - lon_lo;
+        }
+    };
+
+    Box boundingBox(const GeoPoint& center, double radius_m) const {
+        Box box;
+        double dlat = radius_m / kMetersPerDegree;
+        box.lat_lo = latIndex(std::max(-90.0, center.lat - dlat));
+        box.lat_hi = latIndex(std::min(90.0, center.lat + dlat));
+
+        // 经度方向的跨度随纬度变窄，按矩形内最靠近极点的纬度估算；跨越极点时扫描整圈
+        double max_abs_lat = std::min(90.0, std::abs(center.lat) + dlat);
+        double cos_lat = std::cos(max_abs_lat * M_PI / 180.0);
+        int64_t lon_span = lon_cells_;
+        if (cos_lat > 1e-6) {
+            double dlon = radius_m / (kMetersPerDegree * cos_lat);
+            lon_span = std::min<int64_t>(lon_cells_, static_cast<int64_t>(std::ceil(dlon / cell_deg_)) * 2 + 1);
+        }
+        int64_t lon_center = lonIndex(center.lon);
+        box.lon_lo = lon_span >= lon_cells_ ? 0 : lon_center - lon_span / 2;
+        box.lon_hi = lon_span >= lon_cells_ ? lon_cells_ - 1 : lon_center + lon_span / 2;
+        return box;
+    }
+
+    int64_t latIndex(double lat) const {
+        return static_cast<int64_t>(std::floor((lat + 90.0) / cell_deg_));
+    }
+
+    int64_t lonIndex(double lon) const {
+        int64_t idx = static_cast<int64_t>(std::floor((lon + 180.0) / cell_deg_));
+        return std::min(idx, lon_cells_ - 1);
+    }
+
+    static uint64_t cellOf(int64_t lat_idx, int64_t lon_idx) {
+        return (static_cast<uint64_t>(lat_idx) << 32) | static_cast<uint32_t>(lon_idx);
+    }
+
+    // 从格子中交换删除，并修正被挪动条目的下标
+    void detach(const Location& location) {
+        auto cell = cells_.find(location.cell);
+        auto& bucket = cell->second;
+        if (location.index + 1 != bucket.size()) {
+            bucket[location.index] = std::move(bucket.back());
+            locations_[*bucket[location.index].session_id].index = location.index;
+        }
+        bucket.pop_back();
+        if (bucket.empty()) cells_.erase(cell);
+    }
+
+    double cell_deg_;
+    int64_t lon_cells_;
+    std::unordered_map<uint64_t, std::vector<Entry>> cells_;
+    std::unordered_map<std::string, Location> locations_;
+};
@@ -0,0 +1,62 @@
+// online_export.cpp - 会话表导出命令行工具
+// 从 /api/admin/export 流式下载 Arrow IPC 流写入文件，数据不在内存中整体缓存。
+// 写入文件时先写临时文件，完整收到后再改名，下游不会读到半截数据。
+//
+// 用法: online_export [host] [port] [output|-] [zstd|none] [batch_rows]
+//   output 为 - 时写到标准输出；默认 sessions.arrow
+//   服务端设置了 ONLINE_ADMIN_TOKEN 时，本工具从同名环境变量读取令牌
+//   读取示例: pyarrow.ipc.open_stream(open("sessions.arrow", "rb")).read_all()
+#include "../online_client.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    online::ClientOptions opts;
+    if (argc > 1) opts.host = argv[1];
+    if (argc > 2) opts.port = std::atoi(argv[2]);
+    std::string output = argc > 3 ? argv[3] : "sessions.arrow";
+    std::string compression = argc > 4 ? argv[4] : "zstd";
+    size_t batch_rows = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 0;
+    opts.io_timeout_ms = 30000;
+    if (const char* token = std::getenv("ONLINE_ADMIN_TOKEN")) opts.admin_token = token;
+
+    bool to_stdout = output == "-";
+    std::string tmp = output + ".tmp";
+    FILE* out = to_stdout ? stdout : std::fopen(tmp.c_str(), "wb");
+    if (out == nullptr) {
+        std::cerr << "cannot open " << tmp << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    try {
+        online::OnlineClient client(opts);
+        bytes = client.exportSessions([out](const char* data, size_t size) {
+            return std::fwrite(data, 1, size, out) == size;
+        }, compression, batch_rows);
+    } catch (const online::ClientError& e) {
+        std::cerr << e.what() << "\n";
+        if (!to_stdout) {
+            std::fclose(out);
+            std::remove(tmp.c_str());
+        }
+        return 1;
+    }
+
+    if (!to_stdout) {
+        if (std::fclose(out) != 0 || std::rename(tmp.c_str(), output.c_str()) != 0) {
+            std::cerr << "cannot write " << output << "\n";
+            std::remove(tmp.c_str());
+            return 1;
+        }
+    } else {
+        std::fflush(stdout);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "exported %zu bytes to %s in %.3fs\n", bytes, output.c_str(), seconds);
+    return 0;
+}